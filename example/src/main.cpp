@@ -33,6 +33,7 @@ auto main(int argc, char* argv[]) -> int
 	bool dump_lexer = false;
 	bool dump_reader = false;
 	bool pretty_print = false;
+	bool bytecode = false;
 	std::string_view history_path = "~/.blaze-history";
 	std::vector<std::string> arguments;
 
@@ -41,6 +42,7 @@ auto main(int argc, char* argv[]) -> int
 	arg_parser.addOption(dump_lexer, 'l', "dump-lexer", nullptr, nullptr);
 	arg_parser.addOption(dump_reader, 'r', "dump-reader", nullptr, nullptr);
 	arg_parser.addOption(pretty_print, 'c', "color", nullptr, nullptr);
+	arg_parser.addOption(bytecode, 'b', "bytecode", nullptr, nullptr);
 	arg_parser.addOption(history_path, 'h', "history-path", nullptr, nullptr, nullptr, ruc::ArgParser::Required::Yes);
 	// TODO: Add overload for addArgument(std::vector<std::string_view>)
 	arg_parser.addArgument(arguments, "arguments", nullptr, nullptr, ruc::ArgParser::Required::No);
@@ -56,6 +58,7 @@ auto main(int argc, char* argv[]) -> int
 	g_outer_env->set("*DUMP-LEXER*", makePtr<Constant>(dump_lexer));
 	g_outer_env->set("*DUMP-READER*", makePtr<Constant>(dump_reader));
 	g_outer_env->set("*PRETTY-PRINT*", makePtr<Constant>(pretty_print));
+	g_outer_env->set("*BYTECODE*", makePtr<Constant>(bytecode));
 
 	Repl::makeArgv(g_outer_env, arguments);
 
@@ -4,9 +4,16 @@
  * SPDX-License-Identifier: MIT
  */
 
-#include <cstdint> // int64_t
-#include <memory>  // std::static_pointer_cast
+#include <algorithm>  // std::copy, std::equal, std::max
+#include <atomic>     // std::atomic_ref
+#include <bit>        // std::popcount
+#include <cstddef>    // size_t
+#include <cstdint>    // int64_t, uint32_t, uintptr_t
+#include <functional> // std::hash
+#include <iterator>   // std::size
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility> // std::move
 #include <vector>
 
@@ -25,63 +32,222 @@ ValuePtr Value::withMeta(ValuePtr meta) const
 }
 
 ValuePtr Value::meta() const
+{
+	return makePtr<Constant>();
+}
+
+std::string Value::className() const
+{
+	switch (m_type) {
+	case Type::List: return "List";
+	case Type::Vector: return "Vector";
+	case Type::HashMap: return "HashMap";
+	case Type::String: return "String";
+	case Type::Keyword: return "Keyword";
+	case Type::BoxedNumber: return "BoxedNumber";
+	case Type::Symbol: return "Symbol";
+	case Type::Function: return "Function";
+	case Type::Lambda: return "Lambda";
+	case Type::Macro: return "Macro";
+	case Type::Atom: return "Atom";
+	}
+
+	return "Value";
+}
+
+// -----------------------------------------
+
+ValuePtr MetaValue::meta() const
 {
 	return (m_meta == nullptr) ? makePtr<Constant>() : m_meta;
 }
 
 // -----------------------------------------
 
-Collection::Collection(const ValueVector& nodes)
-	: m_nodes(nodes)
+NodeBufferPtr NodeBuffer::create(size_t capacity, size_t begin)
+{
+	auto buffer = NodeBufferPtr(new NodeBuffer(ValueVector(capacity)));
+	buffer->m_begin = begin;
+	buffer->m_end = begin;
+
+	return buffer;
+}
+
+bool NodeBuffer::append(size_t end, ValueSpan nodes)
+{
+	if (end != m_end || m_nodes.size() - m_end < nodes.size()) {
+		return false;
+	}
+
+	std::copy(nodes.begin(), nodes.end(), m_nodes.begin() + m_end);
+	m_end += nodes.size();
+
+	return true;
+}
+
+bool NodeBuffer::prepend(size_t begin, ValueSpan nodes)
+{
+	if (begin != m_begin || m_begin < nodes.size()) {
+		return false;
+	}
+
+	m_begin -= nodes.size();
+	std::copy(nodes.begin(), nodes.end(), m_nodes.begin() + m_begin);
+
+	return true;
+}
+
+void NodeBuffer::trace(Tracer& tracer) const
 {
+	for (size_t i = m_begin; i < m_end; ++i) {
+		tracer.visit(m_nodes[i]);
+	}
 }
 
-Collection::Collection(ValueVector&& nodes) noexcept
-	: m_nodes(std::move(nodes))
+void NodeBuffer::clear()
 {
+	m_nodes.clear();
 }
 
-Collection::Collection(ValueVectorIt begin, ValueVectorIt end)
-	: m_nodes(ValueVector(begin, end))
+// -----------------------------------------
+
+Collection::Collection(Type type, const ValueVector& nodes)
+	: Collection(type, ValueVector(nodes))
 {
 }
 
-Collection::Collection(ValueVectorConstIt begin, ValueVectorConstIt end)
-	: m_nodes(ValueVector(begin, end))
+Collection::Collection(Type type, ValueVector&& nodes) noexcept
+	: MetaValue(type)
+	, m_size(nodes.size())
 {
+	if (m_size > 0) {
+		m_buffer = NodeBufferPtr(new NodeBuffer(std::move(nodes)));
+	}
 }
 
+Collection::Collection(Type type, ValueVectorIt begin, ValueVectorIt end)
+	: Collection(type, ValueVector(begin, end))
+{
+}
+
+Collection::Collection(Type type, ValueVectorConstIt begin, ValueVectorConstIt end)
+	: Collection(type, ValueVector(begin, end))
+{
+}
+
+Collection::Collection(Type type, NodeBufferPtr buffer, size_t offset, size_t size)
+	: MetaValue(type)
+	, m_buffer(std::move(buffer))
+	, m_offset(offset)
+	, m_size(size)
+{
+}
+
+// The nodes never change, so the copy views the same buffer
 Collection::Collection(const Collection& that, ValuePtr meta)
-	: Value(meta)
-	, m_nodes(that.m_nodes)
+	: MetaValue(that.type(), std::move(meta))
+	, m_buffer(that.m_buffer)
+	, m_offset(that.m_offset)
+	, m_size(that.m_size)
+{
+}
+
+ValuePtr Collection::rest() const
+{
+	if (m_size <= 1) {
+		return makePtr<List>();
+	}
+
+	return slice(1, m_size - 1);
+}
+
+ValuePtr Collection::slice(size_t offset, size_t size) const
 {
+	return makePtr<List>(m_buffer, m_offset + offset, size);
 }
 
-ValueVector Collection::rest() const
+ValuePtr Collection::toVector() const
 {
-	auto start = (m_nodes.size() > 0) ? m_nodes.begin() + 1 : m_nodes.end();
-	return ValueVector(start, m_nodes.end());
+	return makePtr<Vector>(m_buffer, m_offset, m_size);
+}
+
+ValuePtr Collection::cons(ValueSpan nodes) const
+{
+	size_t size = nodes.size() + m_size;
+	if (m_buffer && m_buffer->prepend(m_offset, nodes)) {
+		return makePtr<List>(m_buffer, m_offset - nodes.size(), size);
+	}
+
+	// Leave room to grow, so that building a list one node at a time only
+	// copies O(log n) times
+	size_t capacity = std::max(size * 2, s_min_capacity);
+	auto buffer = NodeBuffer::create(capacity, capacity - m_size);
+	buffer->append(capacity - m_size, nodesRead());
+	buffer->prepend(capacity - m_size, nodes);
+
+	return makePtr<List>(std::move(buffer), capacity - size, size);
+}
+
+template<typename T>
+ValuePtr Collection::append(ValueSpan nodes) const
+{
+	size_t size = m_size + nodes.size();
+	if (nodes.empty() || (m_buffer && m_buffer->append(m_offset + m_size, nodes))) {
+		return makePtr<T>(m_buffer, m_offset, size);
+	}
+
+	// Leave room to grow, so that building a collection one node at a time
+	// only copies O(log n) times
+	auto buffer = NodeBuffer::create(std::max(size * 2, s_min_capacity), 0);
+	buffer->append(0, nodesRead());
+	buffer->append(m_size, nodes);
+
+	return makePtr<T>(std::move(buffer), 0, size);
+}
+
+ValuePtr Collection::concat(ValueSpan nodes) const
+{
+	return append<List>(nodes);
+}
+
+void Collection::trace(Tracer& tracer) const
+{
+	MetaValue::trace(tracer);
+	tracer.visit(m_buffer);
+}
+
+void Collection::clear()
+{
+	MetaValue::clear();
+	m_buffer = nullptr;
+	m_offset = 0;
+	m_size = 0;
 }
 
 // -----------------------------------------
 
 List::List(const ValueVector& nodes)
-	: Collection(nodes)
+	: Collection(Type::List, nodes)
 {
 }
 
 List::List(ValueVector&& nodes) noexcept
-	: Collection(std::move(nodes))
+	: Collection(Type::List, std::move(nodes))
 {
 }
 
 List::List(ValueVectorIt begin, ValueVectorIt end)
-	: Collection(begin, end)
+	: Collection(Type::List, begin, end)
 {
 }
 
 List::List(ValueVectorConstIt begin, ValueVectorConstIt end)
-	: Collection(begin, end)
+	: Collection(Type::List, begin, end)
+{
+}
+
+List::List(NodeBufferPtr buffer, size_t offset, size_t size)
+	: Collection(Type::List, std::move(buffer), offset, size)
 {
 }
 
@@ -93,22 +259,27 @@ List::List(const List& that, ValuePtr meta)
 // -----------------------------------------
 
 Vector::Vector(const ValueVector& nodes)
-	: Collection(nodes)
+	: Collection(Type::Vector, nodes)
 {
 }
 
 Vector::Vector(ValueVector&& nodes) noexcept
-	: Collection(std::move(nodes))
+	: Collection(Type::Vector, std::move(nodes))
 {
 }
 
 Vector::Vector(ValueVectorIt begin, ValueVectorIt end)
-	: Collection(begin, end)
+	: Collection(Type::Vector, begin, end)
 {
 }
 
 Vector::Vector(ValueVectorConstIt begin, ValueVectorConstIt end)
-	: Collection(begin, end)
+	: Collection(Type::Vector, begin, end)
+{
+}
+
+Vector::Vector(NodeBufferPtr buffer, size_t offset, size_t size)
+	: Collection(Type::Vector, std::move(buffer), offset, size)
 {
 }
 
@@ -117,175 +288,667 @@ Vector::Vector(const Vector& that, ValuePtr meta)
 {
 }
 
+ValuePtr Vector::conj(ValueSpan nodes) const
+{
+	return append<Vector>(nodes);
+}
+
+// -----------------------------------------
+
+void TrieNode::trace(Tracer& tracer) const
+{
+	for (const auto& [key, value] : entries) {
+		tracer.visit(key);
+		tracer.visit(value);
+	}
+	for (const auto& child : children) {
+		tracer.visit(child);
+	}
+}
+
+void TrieNode::clear()
+{
+	entries.clear();
+	children.clear();
+}
+
+// -----------------------------------------
+
+namespace {
+
+constexpr size_t s_bits = 5;
+constexpr size_t s_hash_bits = 64;
+
+uint32_t slotBit(size_t hash, size_t shift)
+{
+	return 1u << ((hash >> shift) & 31);
+}
+
+// Position of the slot in the array of the bitmap, the slots before it that
+// are in use
+size_t slotIndex(uint32_t map, uint32_t bit)
+{
+	return std::popcount(map & (bit - 1));
+}
+
+// Nodes that are shared with another trie are copied before changing them
+void makeUnique(RefPtr<TrieNode>& node)
+{
+	if (node->refCount() != 1) {
+		node = RefPtr<TrieNode>(new TrieNode(*node));
+	}
+}
+
+// Returns if the key was added, instead of assigned
+bool insertEntry(RefPtr<TrieNode>& node, size_t shift, size_t hash, const ValuePtr& key, const ValuePtr& value)
+{
+	makeUnique(node);
+
+	if (shift >= s_hash_bits) {
+		for (auto& entry : node->entries) {
+			if (valueEqual(entry.first, key)) {
+				entry.second = value;
+				return false;
+			}
+		}
+		node->entries.emplace_back(key, value);
+		return true;
+	}
+
+	uint32_t bit = slotBit(hash, shift);
+	if (node->node_map & bit) {
+		return insertEntry(node->children[slotIndex(node->node_map, bit)], shift + s_bits, hash, key, value);
+	}
+
+	if ((node->data_map & bit) == 0) {
+		node->data_map |= bit;
+		node->entries.insert(node->entries.begin() + slotIndex(node->data_map, bit), { key, value });
+		return true;
+	}
+
+	size_t index = slotIndex(node->data_map, bit);
+	auto& entry = node->entries[index];
+	if (valueEqual(entry.first, key)) {
+		entry.second = value;
+		return false;
+	}
+
+	// Both entries move down into a new child
+	auto child = RefPtr<TrieNode>(new TrieNode);
+	insertEntry(child, shift + s_bits, valueHash(entry.first), entry.first, entry.second);
+	insertEntry(child, shift + s_bits, hash, key, value);
+
+	node->entries.erase(node->entries.begin() + index);
+	node->data_map &= ~bit;
+	node->node_map |= bit;
+	node->children.insert(node->children.begin() + slotIndex(node->node_map, bit), std::move(child));
+
+	return true;
+}
+
+// The key has to be in the trie
+void eraseEntry(RefPtr<TrieNode>& node, size_t shift, size_t hash, const ValuePtr& key)
+{
+	makeUnique(node);
+
+	if (shift >= s_hash_bits) {
+		std::erase_if(node->entries, [&key](const auto& entry) { return valueEqual(entry.first, key); });
+		return;
+	}
+
+	uint32_t bit = slotBit(hash, shift);
+	if (node->data_map & bit) {
+		node->entries.erase(node->entries.begin() + slotIndex(node->data_map, bit));
+		node->data_map &= ~bit;
+		return;
+	}
+
+	size_t index = slotIndex(node->node_map, bit);
+	auto& child = node->children[index];
+	eraseEntry(child, shift + s_bits, hash, key);
+
+	// A child with a single entry left moves back up, so that every child
+	// holds at least two entries
+	if (child->children.empty() && child->entries.size() == 1) {
+		auto entry = std::move(child->entries.front());
+		node->children.erase(node->children.begin() + index);
+		node->node_map &= ~bit;
+		node->data_map |= bit;
+		node->entries.insert(node->entries.begin() + slotIndex(node->data_map, bit), std::move(entry));
+	}
+}
+
+} // namespace
+
+ValuePtr Elements::get(const ValuePtr& key) const
+{
+	size_t hash = valueHash(key);
+	const TrieNode* node = m_root.get();
+	for (size_t shift = 0; node != nullptr; shift += s_bits) {
+		if (shift >= s_hash_bits) {
+			for (const auto& entry : node->entries) {
+				if (valueEqual(entry.first, key)) {
+					return entry.second;
+				}
+			}
+			return nullptr;
+		}
+
+		uint32_t bit = slotBit(hash, shift);
+		if (node->data_map & bit) {
+			const auto& entry = node->entries[slotIndex(node->data_map, bit)];
+			return valueEqual(entry.first, key) ? entry.second : nullptr;
+		}
+		if ((node->node_map & bit) == 0) {
+			return nullptr;
+		}
+		node = node->children[slotIndex(node->node_map, bit)].get();
+	}
+
+	return nullptr;
+}
+
+void Elements::insert_or_assign(const ValuePtr& key, const ValuePtr& value)
+{
+	if (!m_root) {
+		m_root = RefPtr<TrieNode>(new TrieNode);
+	}
+
+	if (insertEntry(m_root, 0, valueHash(key), key, value)) {
+		m_size++;
+	}
+}
+
+void Elements::erase(const ValuePtr& key)
+{
+	// Dont copy any nodes for a key that is not there
+	if (!contains(key)) {
+		return;
+	}
+
+	if (--m_size == 0) {
+		m_root = nullptr;
+		return;
+	}
+
+	eraseEntry(m_root, 0, valueHash(key), key);
+}
+
+void Elements::clear()
+{
+	m_root = nullptr;
+	m_size = 0;
+}
+
+Elements::Iterator::Iterator(const TrieNode* root)
+{
+	if (root != nullptr) {
+		m_stack[m_depth++] = { root, 0, 0 };
+		settle();
+	}
+}
+
+Elements::Iterator& Elements::Iterator::operator++()
+{
+	m_stack[m_depth - 1].entry++;
+	settle();
+	return *this;
+}
+
+Elements::Iterator Elements::Iterator::operator++(int)
+{
+	Iterator copy = *this;
+	++*this;
+	return copy;
+}
+
+bool Elements::Iterator::operator==(const Iterator& other) const
+{
+	if (m_depth == 0 || other.m_depth == 0) {
+		return m_depth == other.m_depth;
+	}
+
+	return top().node == other.top().node && top().entry == other.top().entry;
+}
+
+void Elements::Iterator::settle()
+{
+	while (m_depth > 0) {
+		auto& frame = m_stack[m_depth - 1];
+		if (frame.entry < frame.node->entries.size()) {
+			return;
+		}
+		if (frame.child < frame.node->children.size()) {
+			m_stack[m_depth++] = { frame.node->children[frame.child++].get(), 0, 0 };
+			continue;
+		}
+		m_depth--;
+	}
+}
+
 // -----------------------------------------
 
 HashMap::HashMap(const Elements& elements)
-	: m_elements(elements)
+	: MetaValue(Type::HashMap)
+	, m_elements(elements)
 {
 }
 
 HashMap::HashMap(const HashMap& that, ValuePtr meta)
-	: Value(meta)
+	: MetaValue(Type::HashMap, std::move(meta))
 	, m_elements(that.m_elements)
 {
 }
 
-std::string HashMap::getKeyString(ValuePtr key)
+void HashMap::trace(Tracer& tracer) const
 {
-	if (!is<String>(key.get()) && !is<Keyword>(key.get())) {
-		Error::the().add(::format("wrong argument type: string or keyword, {}", key));
-		return {};
-	}
+	MetaValue::trace(tracer);
+	m_elements.trace(tracer);
+}
 
-	return is<String>(key.get())
-	           ? std::static_pointer_cast<String>(key)->data()
-	           : std::static_pointer_cast<Keyword>(key)->keyword();
+void HashMap::clear()
+{
+	MetaValue::clear();
+	m_elements.clear();
 }
 
-bool HashMap::exists(const std::string& key)
+// -----------------------------------------
+
+namespace {
+
+// Spread the bits over the whole hash, small numbers like the id of a Keyword
+// would otherwise only use the first few slots of every level of the trie
+size_t mix(size_t hash)
 {
-	return m_elements.find(key) != m_elements.end();
+	hash ^= hash >> 30;
+	hash *= 0xbf58476d1ce4e5b9;
+	hash ^= hash >> 27;
+	hash *= 0x94d049bb133111eb;
+	hash ^= hash >> 31;
+	return hash;
 }
 
-bool HashMap::exists(ValuePtr key)
+// Numbers are compared as a double, so that 1 and 1.0 are equal
+double numericValue(const ValuePtr& value)
 {
-	return exists(getKeyString(key));
+	return is<Number>(value) ? static_cast<double>(valueCast<Number>(value)->number())
+	                         : valueCast<Decimal>(value)->decimal();
 }
 
-ValuePtr HashMap::get(const std::string& key)
+} // namespace
+
+bool valueEqual(const ValuePtr& lhs, const ValuePtr& rhs)
 {
-	if (!exists(key)) {
-		return nullptr;
+	if (lhs.isObject() && lhs == rhs) {
+		return true;
+	}
+
+	if (is<Collection>(lhs) && is<Collection>(rhs)) {
+		auto lhs_nodes = valueCast<Collection>(lhs)->nodesRead();
+		auto rhs_nodes = valueCast<Collection>(rhs)->nodesRead();
+		return std::equal(lhs_nodes.begin(), lhs_nodes.end(), rhs_nodes.begin(), rhs_nodes.end(), valueEqual);
+	}
+	if (is<HashMap>(lhs) && is<HashMap>(rhs)) {
+		const auto& lhs_elements = valueCast<HashMap>(lhs)->elements();
+		const auto& rhs_elements = valueCast<HashMap>(rhs)->elements();
+		if (lhs_elements.size() != rhs_elements.size()) {
+			return false;
+		}
+
+		for (const auto& [key, value] : lhs_elements) {
+			auto rhs_value = rhs_elements.get(key);
+			if (!rhs_value || !valueEqual(value, rhs_value)) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+	if (is<String>(lhs) && is<String>(rhs)) {
+		return valueCast<String>(lhs)->data() == valueCast<String>(rhs)->data();
+	}
+	if (is<Keyword>(lhs) && is<Keyword>(rhs)) {
+		return lhs == rhs;
+	}
+	if (is<Numeric>(lhs) && is<Numeric>(rhs)) {
+		return numericValue(lhs) == numericValue(rhs);
+	}
+	if (is<Constant>(lhs) && is<Constant>(rhs)) {
+		return valueCast<Constant>(lhs)->state() == valueCast<Constant>(rhs)->state();
+	}
+	if (is<Symbol>(lhs) && is<Symbol>(rhs)) {
+		return valueCast<Symbol>(lhs)->id() == valueCast<Symbol>(rhs)->id();
+	}
+
+	return false;
+}
+
+size_t valueHash(const ValuePtr& value)
+{
+	// A Number and a Decimal that are equal hash the same
+	if (is<Numeric>(value)) {
+		return std::hash<double> {}(numericValue(value));
+	}
+	if (is<String>(value)) {
+		return std::hash<std::string> {}(valueCast<String>(value)->data());
+	}
+	if (is<Keyword>(value)) {
+		return mix(static_cast<size_t>(valueCast<Keyword>(value)->id()) << 1);
+	}
+	if (is<Symbol>(value)) {
+		return mix((static_cast<size_t>(valueCast<Symbol>(value)->id()) << 1) | 1);
+	}
+	if (is<Constant>(value)) {
+		return mix(~static_cast<size_t>(valueCast<Constant>(value)->state()));
+	}
+	if (is<Collection>(value)) {
+		return valueCast<Collection>(value)->hash();
+	}
+	if (is<HashMap>(value)) {
+		return valueCast<HashMap>(value)->hash();
+	}
+
+	// Functions and atoms
+	return mix(reinterpret_cast<uintptr_t>(value.get()));
+}
+
+// Values are never changed after they are made, so the hash stays valid.
+// Lists and vectors hash the same, as they can be equal.
+size_t Collection::hash() const
+{
+	size_t hash = std::atomic_ref(m_hash).load(std::memory_order_relaxed);
+	if (hash != 0) {
+		return hash;
 	}
 
-	return m_elements[key];
+	hash = m_size;
+	for (const auto& node : nodesRead()) {
+		hash = hash * 31 + valueHash(node);
+	}
+	hash = std::max(mix(hash), size_t { 1 });
+
+	std::atomic_ref(m_hash).store(hash, std::memory_order_relaxed);
+	return hash;
 }
 
-ValuePtr HashMap::get(ValuePtr key)
+// The entries are summed, as the order of the trie depends on the hashes
+size_t HashMap::hash() const
 {
-	return get(getKeyString(key));
+	size_t hash = std::atomic_ref(m_hash).load(std::memory_order_relaxed);
+	if (hash != 0) {
+		return hash;
+	}
+
+	hash = m_elements.size();
+	for (const auto& [key, value] : m_elements) {
+		hash += mix(valueHash(key) * 31 + valueHash(value));
+	}
+	hash = std::max(mix(hash), size_t { 1 });
+
+	std::atomic_ref(m_hash).store(hash, std::memory_order_relaxed);
+	return hash;
 }
 
 // -----------------------------------------
 
 String::String(const std::string& data)
-	: m_data(data)
+	: Value(Type::String)
+	, m_data(data)
 {
 }
 
 String::String(char character)
-	: m_data(std::string(1, character))
+	: Value(Type::String)
+	, m_data(std::string(1, character))
 {
 }
 
 // -----------------------------------------
 
-Keyword::Keyword(const std::string& data)
-	: m_data(std::string(1, 0x7f) + data) // 127
+Keyword::Keyword(std::string_view data, uint32_t id)
+	: Value(Type::Keyword)
+	, m_data(data)
+	, m_id(id)
 {
 }
 
-Keyword::Keyword(int64_t number)
-	: m_data(std::string(1, 0x7f) + std::to_string(number)) // 127
+ValuePtr Keyword::create(std::string_view keyword)
 {
+	// The keys view the name of the Keyword, which is never freed
+	static std::unordered_map<std::string_view, ValuePtr> keywords;
+
+	auto it = keywords.find(keyword);
+	if (it != keywords.end()) {
+		return it->second;
+	}
+
+	auto result = ValuePtr(new Keyword(keyword, keywords.size()));
+	keywords.emplace(valueCast<Keyword>(result)->keyword(), result);
+
+	return result;
+}
+
+ValuePtr Keyword::create(int64_t number)
+{
+	return create(std::to_string(number));
 }
 
 // -----------------------------------------
 
-Number::Number(int64_t number)
-	: Numeric()
+BoxedNumber::BoxedNumber(int64_t number)
+	: Value(Type::BoxedNumber)
 	, m_number(number)
 {
 }
 
-Decimal::Decimal(double decimal)
-	: Numeric()
-	, m_decimal(decimal)
+// -----------------------------------------
+
+Symbol::Symbol(std::string_view symbol, uint32_t id)
+	: Value(Type::Symbol)
+	, m_symbol(symbol)
+	, m_id(id)
 {
 }
 
-// -----------------------------------------
+struct Symbol::Table {
+	ValuePtr intern(std::string_view symbol)
+	{
+		auto it = ids.find(symbol);
+		if (it != ids.end()) {
+			return symbols[it->second];
+		}
 
-Constant::Constant(State state)
-	: m_state(state)
+		uint32_t id = symbols.size();
+		auto result = ValuePtr(new Symbol(symbol, id));
+		symbols.push_back(result);
+		// The key views the name of the Symbol, which is never freed
+		ids.emplace(static_cast<Symbol*>(result.get())->symbol(), id);
+
+		return result;
+	}
+
+	std::unordered_map<std::string_view, uint32_t> ids;
+	std::vector<ValuePtr> symbols;
+};
+
+Symbol::Table& Symbol::table()
 {
+	static Table table = [] {
+		static constexpr std::string_view predefined[] = {
+			// Special forms
+			"and", "def!", "defmacro!", "describe", "do", "fn*", "if", "let*",
+			"macroexpand-1", "or", "quasiquote", "quasiquoteexpand", "quote",
+			"try*", "while",
+			// Other
+			"&", "catch*", "concat", "cons", "deref", "splice-unquote",
+			"unquote", "vec", "with-meta",
+			// Intrinsics
+			"+", "-", "*", "/", "%", "<", "<=", ">", ">=", "=", "not", "nil?"
+		};
+		static_assert(std::size(predefined) == PredefinedCount);
+
+		Table table;
+		for (auto symbol : predefined) {
+			table.intern(symbol);
+		}
+		return table;
+	}();
+
+	return table;
 }
 
-Constant::Constant(bool state)
-	: m_state(state ? Constant::True : Constant::False)
+ValuePtr Symbol::create(std::string_view symbol)
 {
+	return table().intern(symbol);
 }
 
-// -----------------------------------------
+ValuePtr Symbol::create(uint32_t id)
+{
+	return table().symbols[id];
+}
+
+const Symbol* Symbol::find(std::string_view symbol)
+{
+	auto& symbols = table();
+	auto it = symbols.ids.find(symbol);
+	if (it == symbols.ids.end()) {
+		return nullptr;
+	}
+
+	return find(it->second);
+}
 
-Symbol::Symbol(const std::string& symbol)
-	: m_symbol(symbol)
+const Symbol* Symbol::find(uint32_t id)
 {
+	return static_cast<const Symbol*>(table().symbols[id].get());
 }
 
 // -----------------------------------------
 
-Callable::Callable(ValuePtr meta)
-	: Value(meta)
+Callable::Callable(Type type, ValuePtr meta)
+	: MetaValue(type, std::move(meta))
 {
 }
 
 // -----------------------------------------
 
-Function::Function(std::string_view name, std::string_view bindings, std::string_view documentation, FunctionType function)
-	: Callable()
+Function::Function(std::string_view name, std::string_view bindings, std::string_view documentation,
+                   size_t min_arguments, size_t max_arguments, FunctionType function)
+	: Callable(Type::Function)
 	, m_name(name)
 	, m_bindings(bindings)
 	, m_documentation(documentation)
+	, m_min_arguments(min_arguments)
+	, m_max_arguments(max_arguments)
 	, m_function(function)
 {
 }
 
 Function::Function(const Function& that, ValuePtr meta)
-	: Callable(meta)
+	: Callable(Type::Function, std::move(meta))
 	, m_name(that.m_name)
+	, m_bindings(that.m_bindings)
+	, m_documentation(that.m_documentation)
+	, m_min_arguments(that.m_min_arguments)
+	, m_max_arguments(that.m_max_arguments)
 	, m_function(that.m_function)
 {
 }
 
+ValuePtr Function::wrongArgumentCount(size_t size) const
+{
+	Error::the().add(::format("wrong number of arguments: {}, {}", m_name, size));
+	return nullptr;
+}
+
 // -----------------------------------------
 
-Lambda::Lambda(const std::vector<std::string>& bindings, ValuePtr body, EnvironmentPtr env)
-	: Callable()
+Lambda::Lambda(const std::vector<uint32_t>& bindings, ScopePtr scope, ValuePtr body, ExecutablePtr executable, EnvironmentPtr env)
+	: Callable(Type::Lambda)
+	, m_bindings(bindings)
+	, m_scope(std::move(scope))
+	, m_body(std::move(body))
+	, m_env(std::move(env))
+	, m_executable(std::move(executable))
+{
+}
+
+Lambda::Lambda(const std::vector<uint32_t>& bindings, ScopePtr scope, ValuePtr body, ChunkPtr chunk, EnvironmentPtr env)
+	: Callable(Type::Lambda)
 	, m_bindings(bindings)
-	, m_body(body)
-	, m_env(env)
+	, m_scope(std::move(scope))
+	, m_body(std::move(body))
+	, m_env(std::move(env))
+	, m_chunk(std::move(chunk))
 {
 }
 
 Lambda::Lambda(const Lambda& that)
-	: Callable()
+	: Lambda(that, Type::Lambda)
+{
+}
+
+Lambda::Lambda(const Lambda& that, Type type)
+	: Callable(type)
 	, m_bindings(that.m_bindings)
+	, m_scope(that.m_scope)
 	, m_body(that.m_body)
 	, m_env(that.m_env)
+	, m_executable(that.m_executable)
+	, m_chunk(that.m_chunk)
 {
 }
 
 Lambda::Lambda(const Lambda& that, ValuePtr meta)
-	: Callable(meta)
+	: Callable(Type::Lambda, std::move(meta))
 	, m_bindings(that.m_bindings)
+	, m_scope(that.m_scope)
 	, m_body(that.m_body)
 	, m_env(that.m_env)
+	, m_executable(that.m_executable)
+	, m_chunk(that.m_chunk)
+{
+}
+
+// The analyzed body and the Chunk are not reported, so whatever they
+// reference is always considered in use
+void Lambda::trace(Tracer& tracer) const
 {
+	MetaValue::trace(tracer);
+	tracer.visit(m_body);
+	tracer.visit(m_env);
+}
+
+void Lambda::clear()
+{
+	MetaValue::clear();
+	m_body = nullptr;
+	m_env = nullptr;
 }
 
 // -----------------------------------------
 
 Macro::Macro(const Lambda& that)
-	: Lambda(that)
+	: Lambda(that, Type::Macro)
 {
 }
 
 // -----------------------------------------
 
 Atom::Atom(ValuePtr pointer)
-	: m_value(pointer)
+	: Value(Type::Atom)
+	, m_value(std::move(pointer))
+{
+}
+
+void Atom::trace(Tracer& tracer) const
+{
+	tracer.visit(m_value);
+}
+
+void Atom::clear()
 {
+	m_value = nullptr;
 }
 
 } // namespace blaze
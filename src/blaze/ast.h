@@ -6,70 +6,91 @@
 
 #pragma once
 
-#include <concepts>   // std::derived_from, std::same_as
-#include <cstdint>    // int64_t, uint8_t
-#include <functional> // std::function
+#include <array>
+#include <concepts> // std::derived_from, std::same_as
+#include <cstddef>  // ptrdiff_t, size_t
+#include <cstdint>  // int64_t, uint8_t, uint32_t
+#include <iterator> // std::forward_iterator_tag
+#include <limits>   // std::numeric_limits
 #include <list>
-#include <map>
-#include <memory> // std::make_shared, std::shared_ptr
 #include <span>
 #include <string>
 #include <string_view>
-#include <typeinfo> // typeid
-#include <utility>  // std::forward
+#include <utility> // std::forward, std::move, std::pair
 #include <vector>
 
 #include "ruc/format/formatter.h"
 
 #include "blaze/forward.h"
 #include "blaze/to-from-hashmap.h"
+#include "blaze/value-ptr.h"
 
 namespace blaze {
 
 template<typename T, typename... Args>
-std::shared_ptr<T> makePtr(Args&&... args)
-{
-	return std::make_shared<T>(std::forward<Args>(args)...);
-}
+ValuePtr makePtr(Args&&... args);
 
 // -----------------------------------------
 
-class Value {
+class Value : public RefCounted {
 public:
+	// Ordered so that the subtypes of a base class form a contiguous range
+	enum class Type : uint8_t {
+		List,   // Collection
+		Vector, // Collection
+		HashMap,
+		String,
+		Keyword,
+		BoxedNumber,
+		Symbol,
+		Function, // Callable
+		Lambda,   // Callable
+		Macro,    // Callable
+		Atom,
+	};
+
 	virtual ~Value() = default;
 
 	virtual ValuePtr withMetaImpl(ValuePtr meta) const = 0;
 
 	ValuePtr withMeta(ValuePtr meta) const;
-	ValuePtr meta() const;
+	virtual ValuePtr meta() const;
 
-	std::string className() const { return typeid(*this).name(); }
+	Type type() const { return m_type; }
+	std::string className() const;
 
 	template<typename T>
 	bool fastIs() const = delete;
 
-	virtual bool isCollection() const { return false; }
-	virtual bool isList() const { return false; }
-	virtual bool isVector() const { return false; }
-	virtual bool isHashMap() const { return false; }
-	virtual bool isString() const { return false; }
-	virtual bool isKeyword() const { return false; }
-	virtual bool isNumeric() const { return false; }
-	virtual bool isNumber() const { return false; }
-	virtual bool isDecimal() const { return false; }
-	virtual bool isConstant() const { return false; }
-	virtual bool isSymbol() const { return false; }
-	virtual bool isCallable() const { return false; }
-	virtual bool isFunction() const { return false; }
-	virtual bool isLambda() const { return false; }
-	virtual bool isMacro() const { return false; }
-	virtual bool isAtom() const { return false; }
+protected:
+	Value(Type type)
+		: m_type(type)
+	{
+	}
+
+private:
+	const Type m_type;
+};
+
+// Only the types that support with-meta pay for the metadata field
+class MetaValue : public Value {
+public:
+	virtual ~MetaValue() = default;
+
+	virtual ValuePtr meta() const override;
+
+	virtual void trace(Tracer& tracer) const override { tracer.visit(m_meta); }
+	virtual void clear() override { m_meta = nullptr; }
 
 protected:
-	Value() {}
+	MetaValue(Type type)
+		: Value(type)
+	{
+	}
 
-	Value(ValuePtr meta)
-		: m_meta(meta)
+	MetaValue(Type type, ValuePtr meta)
+		: Value(type)
+		, m_meta(std::move(meta))
 	{
 	}
 
@@ -79,7 +100,7 @@ protected:
 #define WITH_META(Type)                                         \
 	virtual ValuePtr withMetaImpl(ValuePtr meta) const override \
 	{                                                           \
-		return std::make_shared<Type>(*this, meta);             \
+		return makePtr<Type>(*this, meta);                      \
 	}
 
 #define WITH_NO_META()                                     \
@@ -90,46 +111,115 @@ protected:
 
 // -----------------------------------------
 
-template<typename T>
-concept IsValue = std::same_as<Value, T> || std::derived_from<T, Value>;
-
-class Collection : public Value {
+// Storage of the nodes of a Collection, shared with the collections created
+// from it. A collection only sees its own part of the buffer, and that part
+// never changes. The buffer is never reallocated, so spans into it stay valid
+// for as long as the collection is alive.
+//
+// The used part can have free space on both sides, so that vectors can grow
+// at the end and lists at the front.
+class NodeBuffer final : public RefCounted {
 public:
-	virtual ~Collection() = default;
+	NodeBuffer(ValueVector&& nodes)
+		: m_nodes(std::move(nodes))
+		, m_end(m_nodes.size())
+	{
+	}
 
-	// TODO: rename size -> count
-	size_t size() const { return m_nodes.size(); }
-	bool empty() const { return m_nodes.size() == 0; }
+	virtual ~NodeBuffer() = default;
+
+	// Empty buffer with room for capacity nodes, used from index begin on
+	static RefPtr<NodeBuffer> create(size_t capacity, size_t begin);
+
+	const ValuePtr* data() const { return m_nodes.data(); }
+
+	// Put the nodes in the free space after or before the used part of the
+	// buffer. This only works once for every version, the one that ends or
+	// begins where the used part does, all the others have to copy.
+	bool append(size_t end, ValueSpan nodes);
+	bool prepend(size_t begin, ValueSpan nodes);
 
-	ValuePtr front() const { return m_nodes.front(); }
-	ValueVector rest() const;
+	// See Collector
+	virtual bool traceable() const override { return true; }
+	virtual void trace(Tracer& tracer) const override;
+	virtual void clear() override;
 
-	ValueVectorConstIt begin() const { return m_nodes.cbegin(); }
-	ValueVectorConstIt end() const { return m_nodes.cend(); }
-	ValueVectorConstReverseIt beginReverse() const { return m_nodes.crbegin(); }
-	ValueVectorConstReverseIt endReverse() const { return m_nodes.crend(); }
+private:
+	ValueVector m_nodes; // Never resized, the slots outside of the used part are empty
+	size_t m_begin { 0 };
+	size_t m_end { 0 };
+};
 
-	const ValueVector& nodesCopy() const { return m_nodes; }
-	std::span<const ValuePtr> nodesRead() const { return m_nodes; }
+typedef RefPtr<NodeBuffer> NodeBufferPtr;
+
+// -----------------------------------------
+
+class Collection : public MetaValue {
+public:
+	virtual ~Collection() = default;
+
+	// TODO: rename size -> count
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+
+	const ValuePtr& front() const { return m_buffer->data()[m_offset]; }
+	// List of all nodes but the first, viewing the same buffer
+	ValuePtr rest() const;
+	// List of size nodes starting at offset, viewing the same buffer
+	ValuePtr slice(size_t offset, size_t size) const;
+	ValuePtr toList() const { return slice(0, m_size); }
+	ValuePtr toVector() const;
+	// List with the nodes in front of these, only copies when the buffer has
+	// no room or was already extended by another version, amortized O(1)
+	ValuePtr cons(ValueSpan nodes) const;
+	// List with the nodes added to the end, like cons but at the other side
+	ValuePtr concat(ValueSpan nodes) const;
+
+	ValueSpanIt begin() const { return nodesRead().begin(); }
+	ValueSpanIt end() const { return nodesRead().end(); }
+	ValueSpanReverseIt beginReverse() const { return nodesRead().rbegin(); }
+	ValueSpanReverseIt endReverse() const { return nodesRead().rend(); }
+
+	ValueVector nodesCopy() const { return ValueVector(begin(), end()); }
+	ValueSpan nodesRead() const { return ValueSpan((m_buffer) ? m_buffer->data() + m_offset : nullptr, m_size); }
+
+	// See valueHash
+	size_t hash() const;
+
+	// See Collector
+	virtual bool traceable() const override { return true; }
+	virtual void trace(Tracer& tracer) const override;
+	virtual void clear() override;
 
 protected:
-	Collection() = default;
-	Collection(const ValueVector& nodes);
-	Collection(ValueVector&& nodes) noexcept;
-	Collection(ValueVectorIt begin, ValueVectorIt end);
-	Collection(ValueVectorConstIt begin, ValueVectorConstIt end);
+	Collection(Type type)
+		: MetaValue(type)
+	{
+	}
+
+	Collection(Type type, const ValueVector& nodes);
+	Collection(Type type, ValueVector&& nodes) noexcept;
+	Collection(Type type, ValueVectorIt begin, ValueVectorIt end);
+	Collection(Type type, ValueVectorConstIt begin, ValueVectorConstIt end);
+	Collection(Type type, NodeBufferPtr buffer, size_t offset, size_t size);
 	Collection(const Collection& that, ValuePtr meta);
 
-	template<IsValue... Ts>
-	Collection(std::shared_ptr<Ts>... nodes)
+	template<std::same_as<ValuePtr>... Ts>
+	Collection(Type type, const Ts&... nodes)
+		: Collection(type, ValueVector { nodes... })
 	{
-		m_nodes = { nodes... };
 	}
 
-private:
-	virtual bool isCollection() const override { return true; }
+	// See concat and Vector::conj
+	template<typename T>
+	ValuePtr append(ValueSpan nodes) const;
+
+	NodeBufferPtr m_buffer; // Views size nodes, starting at offset
+	size_t m_offset { 0 };
+	size_t m_size { 0 };
+	mutable size_t m_hash { 0 }; // 0 until computed
 
-	ValueVector m_nodes;
+	static constexpr size_t s_min_capacity = 8;
 };
 
 // -----------------------------------------
@@ -137,25 +227,27 @@ private:
 // ()
 class List final : public Collection {
 public:
-	List() = default;
+	List()
+		: Collection(Type::List)
+	{
+	}
+
 	List(const ValueVector& nodes);
 	List(ValueVector&& nodes) noexcept;
 	List(ValueVectorIt begin, ValueVectorIt end);
 	List(ValueVectorConstIt begin, ValueVectorConstIt end);
+	List(NodeBufferPtr buffer, size_t offset, size_t size);
 	List(const List& that, ValuePtr meta);
 
-	template<IsValue... Ts>
-	List(std::shared_ptr<Ts>... nodes)
-		: Collection(nodes...)
+	template<std::same_as<ValuePtr>... Ts>
+	List(const Ts&... nodes)
+		: Collection(Type::List, nodes...)
 	{
 	}
 
 	virtual ~List() = default;
 
 	WITH_META(List);
-
-private:
-	virtual bool isList() const override { return true; }
 };
 
 // -----------------------------------------
@@ -163,42 +255,143 @@ private:
 // []
 class Vector final : public Collection {
 public:
-	Vector() = default;
+	Vector()
+		: Collection(Type::Vector)
+	{
+	}
+
 	Vector(const ValueVector& nodes);
 	Vector(ValueVector&& nodes) noexcept;
 	Vector(ValueVectorIt begin, ValueVectorIt end);
 	Vector(ValueVectorConstIt begin, ValueVectorConstIt end);
+	Vector(NodeBufferPtr buffer, size_t offset, size_t size);
 	Vector(const Vector& that, ValuePtr meta);
 
-	template<IsValue... Ts>
-	Vector(std::shared_ptr<Ts>... nodes)
-		: Collection(nodes...)
+	template<std::same_as<ValuePtr>... Ts>
+	Vector(const Ts&... nodes)
+		: Collection(Type::Vector, nodes...)
 	{
 	}
 
 	virtual ~Vector() = default;
 
-	WITH_META(Vector);
+	// Vector with the nodes added to the end, only copies when the buffer is
+	// full or already extended by another version, amortized O(1)
+	ValuePtr conj(ValueSpan nodes) const;
 
-private:
-	virtual bool isVector() const override { return true; }
+	WITH_META(Vector);
 };
 
 // -----------------------------------------
 
-using Elements = std::map<std::string, ValuePtr>;
+// Structural equality, used by = and for the keys of a HashMap. Lists and
+// vectors with equal nodes are equal, numbers are compared by their value.
+// Functions and atoms are only equal to themselves.
+bool valueEqual(const ValuePtr& lhs, const ValuePtr& rhs);
+
+// Hash that agrees with valueEqual, collections and hash-maps compute theirs
+// once and keep it
+size_t valueHash(const ValuePtr& value);
+
+// Node of the trie in Elements. Every level uses 5 bits of the hash, which
+// select one of 32 slots. A slot holds either an entry or a child node, the
+// bitmaps tell which slots are in use and the arrays only store those.
+// Keys whose hashes are equal end up in a node at the bottom, which is
+// searched linearly.
+struct TrieNode final : public RefCounted {
+	using Entry = std::pair<ValuePtr, ValuePtr>;
+
+	virtual ~TrieNode() = default;
+
+	// See Collector
+	virtual bool traceable() const override { return true; }
+	virtual void trace(Tracer& tracer) const override;
+	virtual void clear() override;
+
+	uint32_t data_map { 0 };
+	uint32_t node_map { 0 };
+	std::vector<Entry> entries;
+	std::vector<RefPtr<TrieNode>> children;
+};
+
+// Persistent hash array mapped trie, copies share all of their nodes.
+// Changing a copy copies the nodes on the path to the key, nodes that are not
+// shared with another copy are changed in place.
+// https://lampwww.epfl.ch/papers/idealhashtrees.pdf
+class Elements {
+public:
+	using Entry = TrieNode::Entry;
+
+	class Iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = Entry;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const Entry*;
+		using reference = const Entry&;
+
+		Iterator() = default;
+		explicit Iterator(const TrieNode* root);
+
+		reference operator*() const { return top().node->entries[top().entry]; }
+		pointer operator->() const { return &**this; }
+
+		Iterator& operator++();
+		Iterator operator++(int);
+
+		bool operator==(const Iterator& other) const;
+
+	private:
+		struct Frame {
+			const TrieNode* node;
+			size_t entry;
+			size_t child;
+		};
+
+		const Frame& top() const { return m_stack[m_depth - 1]; }
+		// Move to the next entry, depth first
+		void settle();
+
+		std::array<Frame, 16> m_stack {};
+		size_t m_depth { 0 };
+	};
+
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+
+	Iterator begin() const { return Iterator(m_root.get()); }
+	Iterator end() const { return Iterator(); }
+
+	// Value of the key, nullptr if it is not in the trie
+	ValuePtr get(const ValuePtr& key) const;
+	bool contains(const ValuePtr& key) const { return get(key) != nullptr; }
+
+	void insert_or_assign(const ValuePtr& key, const ValuePtr& value);
+	void erase(const ValuePtr& key);
+
+	void trace(Tracer& tracer) const { tracer.visit(m_root); }
+	void clear();
+
+private:
+	RefPtr<TrieNode> m_root;
+	size_t m_size { 0 };
+};
 
 // {}
-class HashMap final : public Value {
+class HashMap final : public MetaValue {
 public:
-	HashMap() = default;
+	HashMap()
+		: MetaValue(Type::HashMap)
+	{
+	}
+
 	HashMap(const Elements& elements);
 	HashMap(const HashMap& that, ValuePtr meta);
 	virtual ~HashMap() = default;
 
 	static HashMapPtr create(const Elements& elements)
 	{
-		return std::make_shared<HashMap>(elements);
+		return makePtr<HashMap>(elements);
 	}
 
 	// Customization Point
@@ -210,22 +403,25 @@ public:
 		return hash_map;
 	}
 
-	static std::string getKeyString(ValuePtr key);
-
-	bool exists(const std::string& key);
-	bool exists(ValuePtr key);
-	ValuePtr get(const std::string& key);
-	ValuePtr get(ValuePtr key);
+	bool exists(const ValuePtr& key) const { return m_elements.contains(key); }
+	ValuePtr get(const ValuePtr& key) const { return m_elements.get(key); }
 	const Elements& elements() const { return m_elements; }
 	size_t size() const { return m_elements.size(); }
-	bool empty() const { return m_elements.size() == 0; }
+	bool empty() const { return m_elements.empty(); }
+
+	// See valueHash
+	size_t hash() const;
+
+	// See Collector
+	virtual bool traceable() const override { return true; }
+	virtual void trace(Tracer& tracer) const override;
+	virtual void clear() override;
 
 	WITH_META(HashMap);
 
 private:
-	virtual bool isHashMap() const override { return true; }
-
 	Elements m_elements;
+	mutable size_t m_hash { 0 }; // 0 until computed
 };
 
 // -----------------------------------------
@@ -239,7 +435,7 @@ public:
 
 	static ValuePtr create(const std::string& data)
 	{
-		return std::make_shared<String>(data);
+		return makePtr<String>(data);
 	}
 
 	const std::string& data() const { return m_data; }
@@ -249,83 +445,100 @@ public:
 	WITH_NO_META();
 
 private:
-	virtual bool isString() const override { return true; }
-
 	const std::string m_data;
 };
 
 // -----------------------------------------
 
 // :keyword
+//
+// Keywords are interned like symbols, every name maps to exactly one Keyword
+// for the lifetime of the process.
 class Keyword final : public Value {
 public:
-	Keyword(const std::string& data);
-	Keyword(int64_t number);
 	virtual ~Keyword() = default;
 
-	virtual bool isKeyword() const override { return true; }
+	// Return the Keyword for this name, interning it on first use
+	static ValuePtr create(std::string_view keyword);
+	static ValuePtr create(int64_t number);
+
 
+	// Name without the leading ':'
 	const std::string& keyword() const { return m_data; }
+	// Stable across runs, unlike the address
+	uint32_t id() const { return m_id; }
 
 	WITH_NO_META();
 
 private:
+	Keyword(std::string_view data, uint32_t id);
+
 	const std::string m_data;
+	const uint32_t m_id { 0 };
 };
 
 // -----------------------------------------
 
-class Numeric : public Value {
-public:
-	virtual ~Numeric() = default;
+// Number, Decimal and Constant are immediate values, they are stored inline in
+// the ValuePtr and never allocated. These classes are views of that storage,
+// constructed on demand by makePtr and valueCast.
 
+class Numeric {
 protected:
 	Numeric() = default;
-
-	virtual bool isNumeric() const override { return true; }
 };
 
 // 123
 class Number final : public Numeric {
 public:
-	Number(int64_t number);
-	virtual ~Number() = default;
+	explicit Number(int64_t number)
+		: m_number(number)
+	{
+	}
 
 	int64_t number() const { return m_number; }
 
-	WITH_NO_META();
-
 private:
-	virtual bool isNumber() const override { return true; }
-
-	const int64_t m_number { 0 };
+	int64_t m_number { 0 };
 };
 
 // 123.456
 class Decimal final : public Numeric {
 public:
-	Decimal(double decimal);
-	virtual ~Decimal() = default;
+	explicit Decimal(double decimal)
+		: m_decimal(decimal)
+	{
+	}
 
-	static ValuePtr create(float value)
+	static ValuePtr create(double value)
 	{
-		return std::make_shared<Decimal>(value);
+		return ValuePtr(Decimal(value));
 	}
 
 	double decimal() const { return m_decimal; }
 
+private:
+	double m_decimal { 0 };
+};
+
+// Integers that do not fit in the 49 bits of the immediate representation
+class BoxedNumber final : public Value {
+public:
+	BoxedNumber(int64_t number);
+	virtual ~BoxedNumber() = default;
+
+	int64_t number() const { return m_number; }
+
 	WITH_NO_META();
 
 private:
-	virtual bool isDecimal() const override { return true; }
-
-	const double m_decimal { 0 };
+	const int64_t m_number { 0 };
 };
 
 // -----------------------------------------
 
 // true, false, nil
-class Constant final : public Value {
+class Constant final {
 public:
 	enum State : uint8_t {
 		Nil,
@@ -334,75 +547,162 @@ public:
 	};
 
 	Constant() = default;
-	Constant(State state);
-	Constant(bool state);
-	virtual ~Constant() = default;
+	Constant(State state)
+		: m_state(state)
+	{
+	}
+	Constant(bool state)
+		: m_state(state ? Constant::True : Constant::False)
+	{
+	}
 
 	State state() const { return m_state; }
 
-	WITH_NO_META();
-
 private:
-	virtual bool isConstant() const override { return true; }
-
-	const State m_state { State::Nil };
+	State m_state { State::Nil };
 };
 
 // -----------------------------------------
 
 // Symbols
+//
+// Symbols are interned, every name maps to exactly one Symbol for the lifetime
+// of the process. Comparing symbols and looking them up in an Environment is
+// done on the integer ID instead of the name.
 class Symbol final : public Value {
 public:
-	Symbol(const std::string& symbol);
+	// Symbols the evaluator checks for, interned in this order before any other
+	// symbol so that their IDs are known at compile time. The special forms come
+	// first, so recognizing one is a single comparison.
+	enum Predefined : uint32_t {
+		// Special forms
+		And,              // and
+		Def,              // def!
+		DefMacro,         // defmacro!
+		Describe,         // describe
+		Do,               // do
+		Fn,               // fn*
+		If,               // if
+		Let,              // let*
+		MacroExpand1,     // macroexpand-1
+		Or,               // or
+		QuasiQuote,       // quasiquote
+		QuasiQuoteExpand, // quasiquoteexpand
+		Quote,            // quote
+		Try,              // try*
+		While,            // while
+		SpecialFormCount,
+		// Other
+		Ampersand = SpecialFormCount, // &
+		Catch,                        // catch*
+		Concat,                       // concat
+		Cons,                         // cons
+		Deref,                        // deref
+		SpliceUnquote,                // splice-unquote
+		Unquote,                      // unquote
+		Vec,                          // vec
+		WithMeta,                     // with-meta
+		// Intrinsics, see Eval::intrinsic()
+		Add,          // +
+		Subtract,     // -
+		Multiply,     // *
+		Divide,       // /
+		Modulo,       // %
+		Less,         // <
+		LessEqual,    // <=
+		Greater,      // >
+		GreaterEqual, // >=
+		Equal,        // =
+		Not,          // not
+		IsNil,        // nil?
+		PredefinedCount,
+	};
+
 	virtual ~Symbol() = default;
 
+	// Return the Symbol for this name, interning it on first use
+	static ValuePtr create(std::string_view symbol);
+	static ValuePtr create(uint32_t id);
+	// Return the Symbol for this name, without interning it
+	static const Symbol* find(std::string_view symbol);
+	static const Symbol* find(uint32_t id);
+
 	const std::string& symbol() const { return m_symbol; }
+	uint32_t id() const { return m_id; }
+	bool isSpecialForm() const { return m_id < SpecialFormCount; }
+	static bool isIntrinsic(uint32_t id) { return id >= Add && id < PredefinedCount; }
 
 	WITH_NO_META();
 
 private:
-	virtual bool isSymbol() const override { return true; }
+	Symbol(std::string_view symbol, uint32_t id);
+
+	struct Table;
+	static Table& table();
+
 
 	const std::string m_symbol;
+	const uint32_t m_id { 0 };
 };
 
 // -----------------------------------------
 
-class Callable : public Value {
+class Callable : public MetaValue {
 public:
 	virtual ~Callable() = default;
 
+	virtual bool traceable() const override { return true; } // See Collector
+
 protected:
-	Callable() = default;
-	Callable(ValuePtr meta);
+	Callable(Type type)
+		: MetaValue(type)
+	{
+	}
 
-private:
-	virtual bool isCallable() const override { return true; }
+	Callable(Type type, ValuePtr meta);
 };
 
 // -----------------------------------------
 
-using FunctionType = std::function<ValuePtr(ValueVectorConstIt, ValueVectorConstIt)>;
+// Builtins get a view of their arguments, which live in the caller
+using FunctionType = ValuePtr (*)(ValueSpan);
 
 class Function final : public Callable {
 public:
-	Function(std::string_view name, std::string_view bindings, std::string_view documentation, FunctionType function);
+	static constexpr size_t Variadic = std::numeric_limits<size_t>::max();
+
+	Function(std::string_view name, std::string_view bindings, std::string_view documentation,
+	         size_t min_arguments, size_t max_arguments, FunctionType function);
 	Function(const Function& that, ValuePtr meta);
 	virtual ~Function() = default;
 
 	std::string_view name() const { return m_name; }
 	std::string_view bindings() const { return m_bindings; }
 	std::string_view documentation() const { return m_documentation; }
-	FunctionType function() const { return m_function; }
+	size_t minArguments() const { return m_min_arguments; }
+	size_t maxArguments() const { return m_max_arguments; }
+
+	// The builtin only runs when the argument count fits its arity
+	ValuePtr call(ValueSpan arguments) const
+	{
+		size_t size = arguments.size();
+		if (size < m_min_arguments || size > m_max_arguments) {
+			return wrongArgumentCount(size);
+		}
+
+		return m_function(arguments);
+	}
 
 	WITH_META(Function);
 
 private:
-	virtual bool isFunction() const override { return true; }
+	ValuePtr wrongArgumentCount(size_t size) const;
 
 	std::string_view m_name;
 	std::string_view m_bindings;
 	std::string_view m_documentation;
+	const size_t m_min_arguments { 0 };
+	const size_t m_max_arguments { Variadic };
 	const FunctionType m_function;
 };
 
@@ -410,23 +710,40 @@ private:
 
 class Lambda : public Callable {
 public:
-	Lambda(const std::vector<std::string>& bindings, ValuePtr body, EnvironmentPtr env);
+	Lambda(const std::vector<uint32_t>& bindings, ScopePtr scope, ValuePtr body, ExecutablePtr executable, EnvironmentPtr env);
+	Lambda(const std::vector<uint32_t>& bindings, ScopePtr scope, ValuePtr body, ChunkPtr chunk, EnvironmentPtr env);
 	Lambda(const Lambda& that);
 	Lambda(const Lambda& that, ValuePtr meta);
 	virtual ~Lambda() = default;
 
-	const std::vector<std::string>& bindings() const { return m_bindings; }
+	const std::vector<uint32_t>& bindings() const { return m_bindings; }
+	const ScopePtr& scope() const { return m_scope; } // Slots of the bindings
 	ValuePtr body() const { return m_body; }
-	EnvironmentPtr env() const { return m_env; }
+	const EnvironmentPtr& env() const { return m_env; }
+
+	// The body prepared by Eval or the VM, whichever engine runs the Lambda
+	// first fills in its own
+	Executable* executable() const { return m_executable.get(); }
+	const ChunkPtr& chunk() const { return m_chunk; }
+	void setExecutable(ExecutablePtr executable) { m_executable = executable; }
+	void setChunk(ChunkPtr chunk) { m_chunk = chunk; }
+
+	// See Collector
+	virtual void trace(Tracer& tracer) const override;
+	virtual void clear() override;
 
 	WITH_META(Lambda);
 
-private:
-	virtual bool isLambda() const override { return true; }
+protected:
+	Lambda(const Lambda& that, Type type);
 
-	const std::vector<std::string> m_bindings;
-	const ValuePtr m_body;
-	const EnvironmentPtr m_env;
+private:
+	const std::vector<uint32_t> m_bindings; // Symbol IDs
+	const ScopePtr m_scope;
+	ValuePtr m_body;
+	EnvironmentPtr m_env;
+	ExecutablePtr m_executable;
+	ChunkPtr m_chunk;
 };
 
 // -----------------------------------------
@@ -436,28 +753,31 @@ public:
 	Macro(const Lambda& that);
 
 	WITH_NO_META();
-
-private:
-	virtual bool isLambda() const override { return false; }
-	virtual bool isMacro() const override { return true; }
 };
 
 // -----------------------------------------
 
 class Atom final : public Value {
 public:
-	Atom() = default;
+	Atom()
+		: Value(Type::Atom)
+	{
+	}
+
 	Atom(ValuePtr pointer);
 	virtual ~Atom() = default;
 
-	ValuePtr reset(ValuePtr value) { return m_value = value; }
-	ValuePtr deref() const { return m_value; }
+	ValuePtr reset(ValuePtr value) { return m_value = std::move(value); }
+	const ValuePtr& deref() const { return m_value; }
+
+	// See Collector
+	virtual bool traceable() const override { return true; }
+	virtual void trace(Tracer& tracer) const override;
+	virtual void clear() override;
 
 	WITH_NO_META();
 
 private:
-	virtual bool isAtom() const override { return true; }
-
 	ValuePtr m_value;
 };
 
@@ -465,54 +785,174 @@ private:
 
 // clang-format off
 template<>
-inline bool Value::fastIs<Collection>() const { return isCollection(); }
+inline bool Value::fastIs<Collection>() const { return m_type >= Type::List && m_type <= Type::Vector; }
 
 template<>
-inline bool Value::fastIs<List>() const { return isList(); }
+inline bool Value::fastIs<List>() const { return m_type == Type::List; }
 
 template<>
-inline bool Value::fastIs<Vector>() const { return isVector(); }
+inline bool Value::fastIs<Vector>() const { return m_type == Type::Vector; }
 
 template<>
-inline bool Value::fastIs<HashMap>() const { return isHashMap(); }
+inline bool Value::fastIs<HashMap>() const { return m_type == Type::HashMap; }
 
 template<>
-inline bool Value::fastIs<String>() const { return isString(); }
+inline bool Value::fastIs<String>() const { return m_type == Type::String; }
 
 template<>
-inline bool Value::fastIs<Keyword>() const { return isKeyword(); }
+inline bool Value::fastIs<Keyword>() const { return m_type == Type::Keyword; }
 
 template<>
-inline bool Value::fastIs<Numeric>() const { return isNumeric(); }
+inline bool Value::fastIs<BoxedNumber>() const { return m_type == Type::BoxedNumber; }
 
 template<>
-inline bool Value::fastIs<Number>() const { return isNumber(); }
+inline bool Value::fastIs<Symbol>() const { return m_type == Type::Symbol; }
 
 template<>
-inline bool Value::fastIs<Decimal>() const { return isDecimal(); }
+inline bool Value::fastIs<Callable>() const { return m_type >= Type::Function && m_type <= Type::Macro; }
 
 template<>
-inline bool Value::fastIs<Constant>() const { return isConstant(); }
+inline bool Value::fastIs<Function>() const { return m_type == Type::Function; }
 
 template<>
-inline bool Value::fastIs<Symbol>() const { return isSymbol(); }
+inline bool Value::fastIs<Lambda>() const { return m_type == Type::Lambda; }
 
 template<>
-inline bool Value::fastIs<Callable>() const { return isCallable(); }
+inline bool Value::fastIs<Macro>() const { return m_type == Type::Macro; }
+
+template<>
+inline bool Value::fastIs<Atom>() const { return m_type == Type::Atom; }
+// clang-format on
+
+// -----------------------------------------
+
+inline ValuePtr::ValuePtr(Value* value)
+	: m_bits(reinterpret_cast<uintptr_t>(static_cast<RefCounted*>(value)))
+{
+	ref();
+}
+
+inline ValuePtr::ValuePtr(Number number)
+{
+	if (number.number() < s_integer_min || number.number() > s_integer_max) {
+		*this = ValuePtr(new BoxedNumber(number.number()));
+		return;
+	}
+
+	m_bits = s_integer_tag | (static_cast<uint64_t>(number.number()) & ~s_integer_tag);
+}
+
+inline ValuePtr::ValuePtr(Decimal decimal)
+{
+	auto bits = std::bit_cast<uint64_t>(decimal.decimal());
+	if (decimal.decimal() != decimal.decimal()) { // NaN, keep only the sign
+		bits = (bits & s_sign_bit) | s_canonical_nan;
+	}
+
+	m_bits = bits + s_double_offset;
+}
+
+inline ValuePtr::ValuePtr(Constant constant)
+{
+	switch (constant.state()) {
+	case Constant::Nil: m_bits = s_nil; break;
+	case Constant::True: m_bits = s_true; break;
+	case Constant::False: m_bits = s_false; break;
+	}
+}
 
+inline int64_t ValuePtr::number() const
+{
+	if (isInteger()) {
+		// Sign-extend the 49-bit payload
+		return static_cast<int64_t>(m_bits << 15) >> 15;
+	}
+
+	return static_cast<const BoxedNumber*>(get())->number();
+}
+
+inline uint8_t ValuePtr::state() const
+{
+	switch (m_bits) {
+	case s_true: return Constant::True;
+	case s_false: return Constant::False;
+	default: return Constant::Nil;
+	}
+}
+
+inline Value* ValuePtr::get() const
+{
+	return isObject() ? static_cast<Value*>(const_cast<RefCounted*>(object())) : nullptr;
+}
+
+template<typename T>
+inline bool ValuePtr::fastIs() const
+{
+	return isObject() && get()->fastIs<T>();
+}
+
+// clang-format off
 template<>
-inline bool Value::fastIs<Function>() const { return isFunction(); }
+inline bool ValuePtr::fastIs<Numeric>() const { return (m_bits & s_integer_tag) != 0 || (isObject() && get()->fastIs<BoxedNumber>()); }
 
 template<>
-inline bool Value::fastIs<Lambda>() const { return isLambda(); }
+inline bool ValuePtr::fastIs<Number>() const { return isInteger() || (isObject() && get()->fastIs<BoxedNumber>()); }
 
 template<>
-inline bool Value::fastIs<Macro>() const { return isMacro(); }
+inline bool ValuePtr::fastIs<Decimal>() const { return isDouble(); }
 
 template<>
-inline bool Value::fastIs<Atom>() const { return isAtom(); }
+inline bool ValuePtr::fastIs<Constant>() const { return isConstant(); }
 // clang-format on
 
+// -----------------------------------------
+
+template<typename T, typename... Args>
+inline ValuePtr makePtr(Args&&... args)
+{
+	if constexpr (std::derived_from<T, Value>) {
+		return ValuePtr(new T(std::forward<Args>(args)...));
+	}
+	else {
+		return ValuePtr(T(std::forward<Args>(args)...));
+	}
+}
+
+// Pointer-like wrapper around an immediate value view, so that casts read the
+// same for immediates and heap objects: valueCast<Number>(value)->number()
+template<typename T>
+class ImmediatePtr {
+public:
+	explicit ImmediatePtr(T value)
+		: m_value(value)
+	{
+	}
+
+	const T* operator->() const { return &m_value; }
+	const T& operator*() const { return m_value; }
+
+private:
+	T m_value;
+};
+
+// Unchecked cast, the type has to be verified with is<T>() first
+template<typename T>
+inline auto valueCast(const ValuePtr& value)
+{
+	if constexpr (std::same_as<T, Number>) {
+		return ImmediatePtr<Number>(Number(value.number()));
+	}
+	else if constexpr (std::same_as<T, Decimal>) {
+		return ImmediatePtr<Decimal>(Decimal(value.decimal()));
+	}
+	else if constexpr (std::same_as<T, Constant>) {
+		return ImmediatePtr<Constant>(Constant(static_cast<Constant::State>(value.state())));
+	}
+	else {
+		return static_cast<T*>(value.get());
+	}
+}
+
 } // namespace blaze
 
 // -----------------------------------------
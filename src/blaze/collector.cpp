@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2023 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <cstddef> // size_t
+#include <vector>  // std::erase
+
+#include "blaze/collector.h"
+#include "blaze/value-ptr.h"
+
+namespace blaze {
+
+// Never destroyed, objects are still released during static destruction
+std::vector<const RefCounted*>& Collector::s_roots = *new std::vector<const RefCounted*>;
+bool Collector::s_collecting = false;
+size_t Collector::s_reclaimed = 0;
+
+namespace {
+
+template<typename Function>
+class Visitor final : public Tracer {
+public:
+	Visitor(Function function)
+		: m_function(function)
+	{
+	}
+
+	virtual void visit(const RefCounted* object) override { m_function(object); }
+
+private:
+	Function m_function;
+};
+
+} // namespace
+
+void RefCounted::possibleRoot() const
+{
+	Collector::possibleRoot(this);
+}
+
+// -----------------------------------------
+
+size_t Collector::collect()
+{
+	if (s_collecting || !RefCounted::isSingleThreaded()) {
+		return 0;
+	}
+	s_collecting = true;
+
+	std::vector<const RefCounted*> roots;
+	size_t freed = freeReleased(roots);
+
+	// Subtract the references between the objects reachable from the roots,
+	// roots reached from an earlier root are handled through that one
+	for (auto& root : roots) {
+		if (root->m_gc_color == Purple) {
+			markGray(root);
+			continue;
+		}
+		root->m_gc_flags &= ~RefCounted::Buffered;
+		root = nullptr;
+	}
+	std::erase(roots, nullptr);
+
+	for (auto root : roots) {
+		scan(root);
+	}
+
+	std::vector<const RefCounted*> garbage;
+	for (auto root : roots) {
+		root->m_gc_flags &= ~RefCounted::Buffered;
+		collectWhite(root, garbage);
+	}
+	freed += freeGarbage(garbage);
+
+	s_reclaimed += freed;
+	s_collecting = false;
+
+	return freed;
+}
+
+void Collector::possibleRoot(const RefCounted* object)
+{
+	if (!object->traceable()) {
+		object->m_gc_flags |= RefCounted::Leaf;
+		return;
+	}
+
+	object->m_gc_color = Purple;
+	object->m_gc_flags |= RefCounted::Buffered;
+	s_roots.push_back(object);
+}
+
+// -----------------------------------------
+
+// Objects released while they were buffered are left for the collector to
+// free, freeing them can release more of the roots
+size_t Collector::freeReleased(std::vector<const RefCounted*>& roots)
+{
+	size_t freed = 0;
+	bool released = true;
+	while (released) {
+		roots.insert(roots.end(), s_roots.begin(), s_roots.end());
+		s_roots.clear();
+
+		released = false;
+		for (auto& root : roots) {
+			if (root->m_ref_count == 0) {
+				delete root;
+				root = nullptr;
+				released = true;
+				++freed;
+			}
+		}
+		std::erase(roots, nullptr);
+	}
+
+	return freed;
+}
+
+// The graphs can be deep, so they are walked with a stack instead of recursion
+
+void Collector::markGray(const RefCounted* object)
+{
+	if (object->m_gc_color == Gray) {
+		return;
+	}
+	object->m_gc_color = Gray;
+
+	std::vector<const RefCounted*> stack { object };
+	auto visitor = Visitor([&stack](const RefCounted* child) {
+		--child->m_ref_count;
+		if (child->m_gc_color != Gray) {
+			child->m_gc_color = Gray;
+			stack.push_back(child);
+		}
+	});
+	while (!stack.empty()) {
+		auto current = stack.back();
+		stack.pop_back();
+		current->trace(visitor);
+	}
+}
+
+// Gray objects that are still referenced from outside are in use, together
+// with everything they reach
+void Collector::scan(const RefCounted* object)
+{
+	std::vector<const RefCounted*> stack { object };
+	auto visitor = Visitor([&stack](const RefCounted* child) {
+		stack.push_back(child);
+	});
+	while (!stack.empty()) {
+		auto current = stack.back();
+		stack.pop_back();
+		if (current->m_gc_color != Gray) {
+			continue;
+		}
+		if (current->m_ref_count > 0) {
+			scanBlack(current);
+			continue;
+		}
+		current->m_gc_color = White;
+		current->trace(visitor);
+	}
+}
+
+void Collector::scanBlack(const RefCounted* object)
+{
+	object->m_gc_color = Black;
+
+	std::vector<const RefCounted*> stack { object };
+	auto visitor = Visitor([&stack](const RefCounted* child) {
+		++child->m_ref_count;
+		if (child->m_gc_color != Black) {
+			child->m_gc_color = Black;
+			stack.push_back(child);
+		}
+	});
+	while (!stack.empty()) {
+		auto current = stack.back();
+		stack.pop_back();
+		current->trace(visitor);
+	}
+}
+
+void Collector::collectWhite(const RefCounted* object, std::vector<const RefCounted*>& garbage)
+{
+	std::vector<const RefCounted*> stack { object };
+	auto visitor = Visitor([&stack](const RefCounted* child) {
+		stack.push_back(child);
+	});
+	while (!stack.empty()) {
+		auto current = stack.back();
+		stack.pop_back();
+		if (current->m_gc_color != White || (current->m_gc_flags & RefCounted::Buffered) != 0) {
+			continue;
+		}
+		current->m_gc_color = Black;
+		garbage.push_back(current);
+		current->trace(visitor);
+	}
+}
+
+size_t Collector::freeGarbage(const std::vector<const RefCounted*>& garbage)
+{
+	// Give back the references markGray() subtracted, so that dropping them
+	// below counts down the objects outside of the garbage correctly
+	auto restore = Visitor([](const RefCounted* child) {
+		++child->m_ref_count;
+	});
+	for (auto object : garbage) {
+		object->trace(restore);
+	}
+
+	// Keep the garbage alive, and out of the roots, until all of it has
+	// dropped its references
+	for (auto object : garbage) {
+		++object->m_ref_count;
+		object->m_gc_flags |= RefCounted::Buffered;
+	}
+	for (auto object : garbage) {
+		const_cast<RefCounted*>(object)->clear();
+	}
+	for (auto object : garbage) {
+		delete object;
+	}
+
+	return garbage.size();
+}
+
+} // namespace blaze
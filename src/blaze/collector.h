@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2023 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef> // size_t
+#include <vector>
+
+#include "blaze/value-ptr.h"
+
+namespace blaze {
+
+// Synchronous cycle collector for the RefCounted objects that can reference
+// each other: Environments, Lambdas, Atoms and the collections between them.
+//
+// An object whose count drops without reaching zero could be the last outside
+// reference to a cycle, so it is buffered as a possible root. A collection
+// subtracts the references between the objects reachable from the roots,
+// whatever ends up with a count of zero is only kept alive by a cycle.
+//
+// The synchronous algorithm of Bacon and Rajan, "Concurrent Cycle Collection
+// in Reference Counted Systems" (2001)
+class Collector {
+public:
+	// Free the garbage cycles, returns the number of objects freed
+	static size_t collect();
+
+	// Collect once enough possible roots have been buffered. Only call this
+	// where no object is half constructed or destroyed.
+	static void collectIfNeeded()
+	{
+		if (s_roots.size() >= s_threshold) {
+			collect();
+		}
+	}
+
+	// Number of objects freed by all collections so far
+	static size_t reclaimed() { return s_reclaimed; }
+
+private:
+	friend class RefCounted;
+
+	enum Color : uint8_t {
+		Black,  // In use, or not looked at
+		Gray,   // Possible member of a cycle
+		White,  // Member of a garbage cycle
+		Purple, // Possible root of a cycle
+	};
+
+	static void possibleRoot(const RefCounted* object);
+
+	static size_t freeReleased(std::vector<const RefCounted*>& roots);
+	static void markGray(const RefCounted* object);
+	static void scan(const RefCounted* object);
+	static void scanBlack(const RefCounted* object);
+	static void collectWhite(const RefCounted* object, std::vector<const RefCounted*>& garbage);
+	static size_t freeGarbage(const std::vector<const RefCounted*>& garbage);
+
+	static constexpr size_t s_threshold = 10000;
+
+	static std::vector<const RefCounted*>& s_roots;
+	static bool s_collecting;
+	static size_t s_reclaimed;
+};
+
+} // namespace blaze
@@ -4,14 +4,17 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <algorithm> // std::find
 #include <filesystem>
-#include <iterator> // std::distance
-#include <memory>   // std::static_pointer_cast
+#include <iterator> // std::distance, std::make_move_iterator
+#include <memory>   // std::make_shared, std::make_unique
+#include <utility>  // std::move
 
 #include "ruc/file.h"
 #include "ruc/format/format.h"
 
 #include "blaze/ast.h"
+#include "blaze/collector.h"
 #include "blaze/env/environment.h"
 #include "blaze/error.h"
 #include "blaze/forward.h"
@@ -21,40 +24,98 @@ namespace blaze {
 
 std::vector<FunctionParts> Environment::s_function_parts;
 std::vector<std::string> Environment::s_lambdas;
+std::array<ValuePtr, Environment::s_intrinsic_count> Environment::s_builtins;
+std::array<bool, Environment::s_intrinsic_count> Environment::s_rebound = [] {
+	std::array<bool, s_intrinsic_count> rebound;
+	rebound.fill(true); // Not installed yet
+	return rebound;
+}();
+
+Scope::Scope(ScopePtr outer, std::vector<uint32_t>&& symbols)
+	: m_outer(outer)
+	, m_symbols(std::move(symbols))
+{
+}
+
+ScopePtr Scope::create(ScopePtr outer, std::vector<uint32_t>&& symbols)
+{
+	return std::make_shared<Scope>(outer, std::move(symbols));
+}
+
+uint32_t Scope::add(uint32_t symbol)
+{
+	uint32_t slot = find(symbol);
+	if (slot != Address::Global) {
+		return slot;
+	}
+
+	m_symbols.push_back(symbol);
+	return m_symbols.size() - 1;
+}
+
+// The last one wins if a fn* has the same symbol in its bindings twice
+uint32_t Scope::find(uint32_t symbol) const
+{
+	auto it = std::find(m_symbols.rbegin(), m_symbols.rend(), symbol);
+	return (it != m_symbols.rend()) ? std::distance(it, m_symbols.rend()) - 1 : Address::Global;
+}
+
+Scope::Address Scope::resolve(const Scope* scope, uint32_t symbol)
+{
+	for (uint32_t depth = 0; scope != nullptr; scope = scope->m_outer.get(), ++depth) {
+		uint32_t slot = scope->find(symbol);
+		if (slot != Address::Global) {
+			return { depth, slot };
+		}
+	}
+
+	return {};
+}
+
+// -----------------------------------------
 
 EnvironmentPtr Environment::create()
 {
-	return std::shared_ptr<Environment>(new Environment);
+	// Environments are created on every call, which makes this a safe point
+	// to collect cycles, see Collector
+	Collector::collectIfNeeded();
+
+	return EnvironmentPtr(new Environment);
 }
 
-EnvironmentPtr Environment::create(EnvironmentPtr outer)
+EnvironmentPtr Environment::create(EnvironmentPtr outer, ScopePtr scope)
 {
 	auto env = create();
 
-	env->m_outer = outer;
+	env->m_outer = std::move(outer);
+	env->m_slots.resize(scope->size());
+	env->m_scope = std::move(scope);
 
 	return env;
 }
 
-EnvironmentPtr Environment::create(const ValuePtr lambda, ValueVector&& arguments)
+EnvironmentPtr Environment::create(const ValuePtr& lambda, ValueVector&& arguments)
 {
-	auto lambda_casted = std::static_pointer_cast<Lambda>(lambda);
-	auto env = create(lambda_casted->env());
-	auto bindings = lambda_casted->bindings();
+	auto lambda_casted = valueCast<Lambda>(lambda);
+	const auto& bindings = lambda_casted->bindings();
+
+	auto env = create();
+	env->m_outer = lambda_casted->env();
+	env->m_scope = lambda_casted->scope();
 
+	// The slots are the bindings in order, without the &
 	auto it = arguments.begin();
 	for (size_t i = 0; i < bindings.size(); ++i, ++it) {
-		if (bindings[i] == "&") {
+		if (bindings[i] == Symbol::Ampersand) {
 			if (i + 2 != bindings.size()) {
 				Error::the().add(::format("invalid function: {}", lambda));
 				return nullptr;
 			}
 
-			auto nodes = ValueVector();
-			for (; it != arguments.end(); ++it) {
-				nodes.push_back(*it);
-			}
-			env->set(bindings[i + 1], makePtr<List>(nodes));
+			auto nodes = ValueVector(std::make_move_iterator(it), std::make_move_iterator(arguments.end()));
+			arguments.resize(i + 1);
+			arguments[i] = makePtr<List>(std::move(nodes));
+			env->m_slots = std::move(arguments);
 
 			return env;
 		}
@@ -63,8 +124,6 @@ EnvironmentPtr Environment::create(const ValuePtr lambda, ValueVector&& argument
 			Error::the().add(::format("wrong number of arguments: {}, {}", lambda, arguments.size()));
 			return nullptr;
 		}
-
-		env->set(bindings[i], *it);
 	}
 
 	if (it != arguments.end()) {
@@ -72,6 +131,8 @@ EnvironmentPtr Environment::create(const ValuePtr lambda, ValueVector&& argument
 		return nullptr;
 	}
 
+	env->m_slots = std::move(arguments);
+
 	return env;
 }
 
@@ -128,51 +189,175 @@ void Environment::registerFunction(FunctionParts function_parts)
 	s_function_parts.push_back(function_parts);
 }
 
-void Environment::installFunctions(EnvironmentPtr env)
+void Environment::installFunctions(const EnvironmentPtr& env)
 {
 	for (const auto& function_parts : s_function_parts) {
-		env->set(std::string(function_parts.name),
+		env->set(function_parts.name,
 		         makePtr<Function>(
 					 function_parts.name,
 					 function_parts.signature,
 					 function_parts.documentation,
+					 function_parts.min_arguments,
+					 function_parts.max_arguments,
 					 function_parts.function));
 	}
 	for (const auto& lambda : s_lambdas) {
 		// Ensure all s-exprs are run with (do)
 		Repl::eval(Repl::read("(do " + lambda + ")"), env);
 	}
+
+	for (uint32_t symbol = Symbol::Add; symbol < Symbol::PredefinedCount; ++symbol) {
+		s_builtins[symbol - Symbol::Add] = env->get(symbol);
+		s_rebound[symbol - Symbol::Add] = s_builtins[symbol - Symbol::Add] == nullptr;
+	}
 }
 
 // -----------------------------------------
 
-bool Environment::exists(std::string_view symbol)
+bool Environment::exists(uint32_t symbol) const
 {
-	return m_values.find(std::string(symbol)) != m_values.end();
+	if (m_outer == nullptr) {
+		return symbol < m_slots.size() && m_slots[symbol] != nullptr;
+	}
+
+	uint32_t slot = m_scope->find(symbol);
+	if (slot != Scope::Address::Global) {
+		return m_slots[slot] != nullptr;
+	}
+
+	return m_values != nullptr && m_values->find(symbol) != m_values->end();
 }
 
-ValuePtr Environment::set(std::string_view symbol, ValuePtr value)
+ValuePtr Environment::set(uint32_t symbol, ValuePtr value)
 {
-	if (exists(symbol)) {
-		m_values.erase(std::string(symbol));
+	if (Symbol::isIntrinsic(symbol)) {
+		s_rebound[symbol - Symbol::Add] = true;
+	}
+
+	if (m_outer == nullptr) {
+		if (symbol >= m_slots.size()) {
+			m_slots.resize(symbol + 1);
+		}
+		return m_slots[symbol] = std::move(value);
 	}
 
-	m_values.emplace(symbol, value);
+	uint32_t slot = m_scope->find(symbol);
+	if (slot != Scope::Address::Global) {
+		return m_slots[slot] = std::move(value);
+	}
+
+	if (m_values == nullptr) {
+		m_values = std::make_unique<std::unordered_map<uint32_t, ValuePtr>>();
+	}
+	m_values->insert_or_assign(symbol, value);
 
 	return value;
 }
 
-ValuePtr Environment::get(std::string_view symbol)
+ValuePtr Environment::get(uint32_t symbol) const
+{
+	auto env = this;
+	for (; env->m_outer != nullptr; env = env->m_outer.get()) {
+		uint32_t slot = env->m_scope->find(symbol);
+		if (slot != Scope::Address::Global && env->m_slots[slot] != nullptr) {
+			return env->m_slots[slot];
+		}
+
+		if (env->m_values != nullptr) {
+			auto it = env->m_values->find(symbol);
+			if (it != env->m_values->end()) {
+				return it->second;
+			}
+		}
+	}
+
+	return (symbol < env->m_slots.size()) ? env->m_slots[symbol] : nullptr;
+}
+
+ValuePtr Environment::get(Scope::Address address, uint32_t symbol) const
+{
+	if (address.slot == Scope::Address::Global) {
+		return getGlobal(symbol);
+	}
+
+	// Variables defined with def! in between shadow the slot
+	auto env = this;
+	for (uint32_t depth = address.depth; depth > 0; --depth) {
+		if (env->m_values != nullptr) {
+			auto it = env->m_values->find(symbol);
+			if (it != env->m_values->end()) {
+				return it->second;
+			}
+		}
+		env = env->m_outer.get();
+	}
+
+	const auto& value = env->m_slots[address.slot];
+	if (value != nullptr) {
+		return value;
+	}
+
+	// Slot is not bound yet, like the x in (let* [x x] ...)
+	return env->m_outer->get(symbol);
+}
+
+ValuePtr Environment::getGlobal(uint32_t symbol) const
+{
+	auto env = this;
+	for (; env->m_outer != nullptr; env = env->m_outer.get()) {
+		if (env->m_values != nullptr) {
+			auto it = env->m_values->find(symbol);
+			if (it != env->m_values->end()) {
+				return it->second;
+			}
+		}
+	}
+
+	return (symbol < env->m_slots.size()) ? env->m_slots[symbol] : nullptr;
+}
+
+bool Environment::exists(std::string_view symbol) const
+{
+	auto interned = Symbol::find(symbol);
+	return interned != nullptr && exists(interned->id());
+}
+
+ValuePtr Environment::set(std::string_view symbol, ValuePtr value)
+{
+	return set(valueCast<Symbol>(Symbol::create(symbol))->id(), std::move(value));
+}
+
+ValuePtr Environment::get(std::string_view symbol) const
 {
-	if (exists(symbol)) {
-		return m_values[std::string(symbol)];
+	// A name that was never interned can not be bound
+	auto interned = Symbol::find(symbol);
+	return (interned != nullptr) ? get(interned->id()) : nullptr;
+}
+
+// -----------------------------------------
+
+void Environment::trace(Tracer& tracer) const
+{
+	if (m_outer == nullptr) {
+		return;
 	}
 
-	if (m_outer) {
-		return m_outer->get(symbol);
+	tracer.visit(m_outer);
+	for (const auto& value : m_slots) {
+		tracer.visit(value);
+	}
+	if (m_values != nullptr) {
+		for (const auto& [_, value] : *m_values) {
+			tracer.visit(value);
+		}
 	}
+}
 
-	return nullptr;
+void Environment::clear()
+{
+	m_outer = nullptr;
+	m_slots.clear();
+	m_values.reset();
 }
 
 } // namespace blaze
@@ -6,9 +6,15 @@
 
 #pragma once
 
+#include <array>
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t
 #include <list>
+#include <memory> // std::unique_ptr
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility> // std::move
 #include <vector>
 
 #include "blaze/ast.h"
@@ -21,25 +27,85 @@ struct FunctionParts {
 	std::string_view name;
 	std::string_view signature;
 	std::string_view documentation;
+	size_t min_arguments;
+	size_t max_arguments;
 	FunctionType function;
 };
 
-class Environment {
+// Layout of the slots of an Environment, built while analyzing a fn*, let* or
+// catch* so that local variables resolve to a (depth, slot) pair. Symbols that
+// resolve to no slot are free variables, looked up in the outer-most
+// Environment.
+class Scope {
+public:
+	struct Address {
+		static constexpr uint32_t Global = UINT32_MAX;
+
+		uint32_t depth { 0 };
+		uint32_t slot { Global };
+	};
+
+	Scope(ScopePtr outer, std::vector<uint32_t>&& symbols);
+	virtual ~Scope() = default;
+
+	static ScopePtr create(ScopePtr outer, std::vector<uint32_t>&& symbols = {});
+
+	// Add a slot for the symbol, if it doesnt have one yet
+	uint32_t add(uint32_t symbol);
+	// Returns Address::Global if the symbol has no slot in this Scope
+	uint32_t find(uint32_t symbol) const;
+
+	static Address resolve(const Scope* scope, uint32_t symbol);
+
+	const ScopePtr& outer() const { return m_outer; }
+	size_t size() const { return m_symbols.size(); }
+
+private:
+	ScopePtr m_outer;
+	std::vector<uint32_t> m_symbols; // Symbol IDs
+};
+
+// -----------------------------------------
+
+class Environment final : public RefCounted {
 public:
 	virtual ~Environment() = default;
 
 	// Factory functions instead of constructors because it can fail in the bindings/arguments case
 	static EnvironmentPtr create();
-	static EnvironmentPtr create(EnvironmentPtr outer);
-	static EnvironmentPtr create(const ValuePtr lambda, ValueVector&& arguments);
+	static EnvironmentPtr create(EnvironmentPtr outer, ScopePtr scope);
+	static EnvironmentPtr create(const ValuePtr& lambda, ValueVector&& arguments);
 
 	static void loadFunctions();
 	static void registerFunction(FunctionParts function_parts);
-	static void installFunctions(EnvironmentPtr env);
+	static void installFunctions(const EnvironmentPtr& env);
+
+	// The value an intrinsic Symbol was bound to at startup, see Eval. Once
+	// the Symbol is bound again anywhere, calls to it are no longer inlined.
+	static const ValuePtr& builtin(uint32_t symbol) { return s_builtins[symbol - Symbol::Add]; }
+	static bool isRebound(uint32_t symbol) { return s_rebound[symbol - Symbol::Add]; }
+
+	// Lookup by Symbol ID, see Symbol::id()
+	bool exists(uint32_t symbol) const;
+	ValuePtr set(uint32_t symbol, ValuePtr value);
+	ValuePtr get(uint32_t symbol) const;
 
-	bool exists(std::string_view symbol);
+	bool exists(std::string_view symbol) const;
 	ValuePtr set(std::string_view symbol, ValuePtr value);
-	ValuePtr get(std::string_view symbol);
+	ValuePtr get(std::string_view symbol) const;
+
+	// Lookup by Address, see Scope::resolve()
+	ValuePtr get(Scope::Address address, uint32_t symbol) const;
+	void setSlot(uint32_t slot, ValuePtr value) { m_slots[slot] = std::move(value); }
+
+	const EnvironmentPtr& outer() const { return m_outer; }
+	const ScopePtr& scope() const { return m_scope; }
+
+	// See Collector. The outer-most Environment lives as long as the program,
+	// so it is never traced.
+	virtual bool traceable() const override { return m_outer != nullptr; }
+	virtual void trace(Tracer& tracer) const override;
+	virtual void clear() override;
 
 private:
 	Environment() {}
@@ -59,11 +125,24 @@ private:
 	static void loadPredicate();
 	static void loadRepl();
 
+	ValuePtr getGlobal(uint32_t symbol) const;
+
 	EnvironmentPtr m_outer { nullptr };
-	std::unordered_map<std::string, ValuePtr> m_values;
+	ScopePtr m_scope; // Names of the slots, nullptr in the outer-most Environment
+
+	// The local variables by slot, or in the outer-most Environment the global
+	// variables by Symbol ID
+	ValueVector m_slots;
+
+	// Variables defined with def! that have no slot in the Scope
+	std::unique_ptr<std::unordered_map<uint32_t, ValuePtr>> m_values;
 
 	static std::vector<FunctionParts> s_function_parts;
 	static std::vector<std::string> s_lambdas;
+
+	static constexpr size_t s_intrinsic_count = Symbol::PredefinedCount - Symbol::Add;
+	static std::array<ValuePtr, s_intrinsic_count> s_builtins;
+	static std::array<bool, s_intrinsic_count> s_rebound;
 };
 
 } // namespace blaze
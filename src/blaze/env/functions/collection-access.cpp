@@ -5,7 +5,6 @@
  */
 
 #include <cstddef> // size_t
-#include <memory>  // std:static_pointer_cast
 
 #include "blaze/ast.h"
 #include "blaze/env/macro.h"
@@ -23,18 +22,17 @@ void Environment::loadCollectionAccess()
 		"count",
 		"",
 		"",
+		1, 1,
 		{
-			CHECK_ARG_COUNT_IS("count", SIZE(), 1);
-
 			size_t result = 0;
-			if (is<Constant>(begin->get()) && std::static_pointer_cast<Constant>(*begin)->state() == Constant::Nil) {
+			if (is<Constant>(*begin) && valueCast<Constant>(*begin)->state() == Constant::Nil) {
 				// result = 0
 			}
-			else if (is<Collection>(begin->get())) {
-				result = std::static_pointer_cast<Collection>(*begin)->size();
+			else if (is<Collection>(*begin)) {
+				result = valueCast<Collection>(*begin)->size();
 			}
-			else if (is<HashMap>(begin->get())) {
-				result = std::static_pointer_cast<HashMap>(*begin)->size();
+			else if (is<HashMap>(*begin)) {
+				result = valueCast<HashMap>(*begin)->size();
 			}
 			else {
 				Error::the().add(::format("wrong argument type: Collection, '{}'", *begin));
@@ -52,11 +50,10 @@ void Environment::loadCollectionAccess()
 		"first",
 		"",
 		"",
+		1, 1,
 		{
-			CHECK_ARG_COUNT_IS("first", SIZE(), 1);
-
-			if (is<Constant>(begin->get())
-		        && std::static_pointer_cast<Constant>(*begin)->state() == Constant::Nil) {
+			if (is<Constant>(*begin)
+		        && valueCast<Constant>(*begin)->state() == Constant::Nil) {
 				return makePtr<Constant>();
 			}
 
@@ -70,9 +67,8 @@ void Environment::loadCollectionAccess()
 		"nth",
 		"",
 		"",
+		2, 2,
 		{
-			CHECK_ARG_COUNT_IS("nth", SIZE(), 2);
-
 			VALUE_CAST(collection, Collection, (*begin));
 			VALUE_CAST(number_node, Number, (*(begin + 1)));
 			auto collection_nodes = collection->nodesRead();
@@ -91,17 +87,16 @@ void Environment::loadCollectionAccess()
 		"rest",
 		"",
 		"",
+		1, 1,
 		{
-			CHECK_ARG_COUNT_IS("rest", SIZE(), 1);
-
-			if (is<Constant>(begin->get())
-		        && std::static_pointer_cast<Constant>(*begin)->state() == Constant::Nil) {
+			if (is<Constant>(*begin)
+		        && valueCast<Constant>(*begin)->state() == Constant::Nil) {
 				return makePtr<List>();
 			}
 
 			VALUE_CAST(collection, Collection, (*begin));
 
-			return makePtr<List>(collection->rest());
+			return collection->rest();
 		});
 
 	// -----------------------------------------
@@ -111,11 +106,10 @@ void Environment::loadCollectionAccess()
 		"get",
 		"",
 		"",
+		1, Function::Variadic,
 		{
-			CHECK_ARG_COUNT_AT_LEAST("get", SIZE(), 1);
-
-			if (is<Constant>(begin->get())
-		        && std::static_pointer_cast<Constant>(*begin)->state() == Constant::Nil) {
+			if (is<Constant>(*begin)
+		        && valueCast<Constant>(*begin)->state() == Constant::Nil) {
 				return makePtr<Constant>();
 			}
 
@@ -135,23 +129,16 @@ void Environment::loadCollectionAccess()
 		"keys",
 		"",
 		"",
+		1, Function::Variadic,
 		{
-			CHECK_ARG_COUNT_AT_LEAST("keys", SIZE(), 1);
-
 			VALUE_CAST(hash_map, HashMap, (*begin));
 
 			size_t count = hash_map->size();
 			auto nodes = ValueVector(count);
 
 			size_t i = 0;
-			auto elements = hash_map->elements();
-			for (auto pair : elements) {
-				if (pair.first.front() == 0x7f) { // 127
-					nodes.at(i) = makePtr<Keyword>(pair.first.substr(1));
-				}
-				else {
-					nodes.at(i) = makePtr<String>(pair.first);
-				}
+			for (const auto& pair : hash_map->elements()) {
+				nodes.at(i) = pair.first;
 				i++;
 			}
 
@@ -163,17 +150,15 @@ void Environment::loadCollectionAccess()
 		"vals",
 		"",
 		"",
+		1, Function::Variadic,
 		{
-			CHECK_ARG_COUNT_AT_LEAST("vals", SIZE(), 1);
-
 			VALUE_CAST(hash_map, HashMap, (*begin));
 
 			size_t count = hash_map->size();
 			auto nodes = ValueVector(count);
 
 			size_t i = 0;
-			auto elements = hash_map->elements();
-			for (auto pair : elements) {
+			for (const auto& pair : hash_map->elements()) {
 				nodes.at(i) = pair.second;
 				i++;
 			}
@@ -5,7 +5,6 @@
  */
 
 #include <cstddef> // size_t
-#include <memory>  // std:static_pointer_cast
 
 #include "blaze/ast.h"
 #include "blaze/env/macro.h"
@@ -21,8 +20,9 @@ void Environment::loadCollectionConstructor()
 		"list",
 		"",
 		"",
+		0, Function::Variadic,
 		{
-			return makePtr<List>(begin, end);
+			return makePtr<List>(ValueVector(begin, end));
 		});
 
 	// (make-list 4 nil) -> (nil nil nil nil)
@@ -30,33 +30,32 @@ void Environment::loadCollectionConstructor()
 		"make-list",
 		"",
 		"",
+		2, 2,
 		{
-			CHECK_ARG_COUNT_IS("make-list", SIZE(), 2);
-
 			VALUE_CAST(number, Number, (*begin));
 			auto count = static_cast<size_t>(number->number() < 0 ? 0 : number->number());
-			auto value = *std::next(begin);
+			const auto& value = *std::next(begin);
 
 			auto nodes = ValueVector(count);
-			if (is<Atom>(value.get())) {
-				auto atom = std::static_pointer_cast<Atom>(value);
+			if (is<Atom>(value)) {
+				auto atom = valueCast<Atom>(value);
 				for (size_t i = 0; i < count; ++i) {
 					nodes[i] = makePtr<Atom>(atom);
 				}
 			}
-			// else if (is<Collection>(value.get())) {
+			// else if (is<Collection>(value)) {
 		    // 	for (size_t i = 0; i < count; ++i) {
-		    // 		auto nodes = std::static_pointer_cast<Collection>(value)->nodesCopy();
-		    // 		if (is<Vector>(value.get())) {
+		    // 		auto nodes = valueCast<Collection>(value)->nodesCopy();
+		    // 		if (is<Vector>(value)) {
 		    // 			makePtr<Vector>(nodes);
 		    // 			continue;
 		    // 		}
 		    // 		nodes[i] = makePtr<List>(nodes);
 		    // 	}
 		    // }
-		    // else if (is<Constant>(value.get())) {
+		    // else if (is<Constant>(value)) {
 		    // 	for (size_t i = 0; i < count; ++i) {
-		    // 		auto constant = std::static_pointer_cast<Constant>(value);
+		    // 		auto constant = valueCast<Constant>(value);
 		    // 		nodes[i] = makePtr<Constant>(constant);
 		    // 	}
 		    // }
@@ -86,16 +85,15 @@ void Environment::loadCollectionConstructor()
 		"vec",
 		"",
 		"",
+		1, 1,
 		{
-			CHECK_ARG_COUNT_IS("vec", SIZE(), 1);
-
-			if (is<Vector>(begin->get())) {
+			if (is<Vector>(*begin)) {
 				return *begin;
 			}
 
 			VALUE_CAST(collection, Collection, (*begin));
 
-			return makePtr<Vector>(collection->nodesCopy());
+			return collection->toVector();
 		});
 
 	// (vector 1 2 3) -> [1 2 3]
@@ -103,10 +101,11 @@ void Environment::loadCollectionConstructor()
 		"vector",
 		"",
 		"",
+		0, Function::Variadic,
 		{
 			auto result = makePtr<Vector>();
 
-			return makePtr<Vector>(begin, end);
+			return makePtr<Vector>(ValueVector(begin, end));
 		});
 
 	// -----------------------------------------
@@ -116,13 +115,14 @@ void Environment::loadCollectionConstructor()
 		"hash-map",
 		"",
 		"",
+		0, Function::Variadic,
 		{
 			CHECK_ARG_COUNT_EVEN("hash-map", SIZE());
 
 			Elements elements;
 			for (auto it = begin; it != end; std::advance(it, 2)) {
 				const ValuePtr& value = *(std::next(it)); // temporary instance to get around const
-				elements.insert_or_assign(HashMap::getKeyString(*it), value);
+				elements.insert_or_assign(*it, value);
 			}
 
 			return makePtr<HashMap>(elements);
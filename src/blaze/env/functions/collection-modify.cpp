@@ -4,9 +4,10 @@
  * SPDX-License-Identifier: MIT
  */
 
-#include <algorithm> // std::copy, std::reverse_copy
+#include <algorithm> // std::copy
 #include <cstddef>   // size_t
-#include <memory>    // std::static_pointer_cast
+#include <iterator>  // std::make_reverse_iterator
+#include <utility>   // std::move
 
 #include "blaze/ast.h"
 #include "blaze/env/environment.h"
@@ -24,10 +25,9 @@ void Environment::loadCollectionModify()
 		"apply",
 		"",
 		"",
+		2, Function::Variadic,
 		{
-			CHECK_ARG_COUNT_AT_LEAST("apply", SIZE(), 2);
-
-			auto callable = *begin;
+			const auto& callable = *begin;
 			IS_VALUE(Callable, callable);
 
 			VALUE_CAST(collection, Collection, (*std::prev(end)));
@@ -41,17 +41,7 @@ void Environment::loadCollectionModify()
 				arguments.push_back(node);
 			}
 
-			ValuePtr value = nullptr;
-			if (is<Function>(callable.get())) {
-				auto function = std::static_pointer_cast<Function>(callable)->function();
-				value = function(arguments.begin(), arguments.end());
-			}
-			else {
-				auto lambda = std::static_pointer_cast<Lambda>(callable);
-				value = Repl::eval(lambda->body(), Environment::create(lambda, std::move(arguments)));
-			}
-
-			return value;
+			return Repl::apply(callable, std::move(arguments));
 		});
 
 	// (cons 1 (list 2 3))
@@ -59,20 +49,11 @@ void Environment::loadCollectionModify()
 		"cons",
 		"",
 		"",
+		2, 2,
 		{
-			CHECK_ARG_COUNT_IS("cons", SIZE(), 2);
-
-			ValuePtr first = *begin;
-			begin++;
-
-			VALUE_CAST(collection, Collection, (*begin));
-			const auto& collection_nodes = collection->nodesRead();
-
-			auto result_nodes = ValueVector(collection_nodes.size() + 1);
-			result_nodes.at(0) = first;
-			std::copy(collection_nodes.begin(), collection_nodes.end(), result_nodes.begin() + 1);
+			VALUE_CAST(collection, Collection, (*(begin + 1)));
 
-			return makePtr<List>(result_nodes);
+			return collection->cons(ValueSpan(begin, 1));
 		});
 
 	// (concat (list 1) (list 2 3)) -> (1 2 3)
@@ -80,6 +61,7 @@ void Environment::loadCollectionModify()
 		"concat",
 		"",
 		"",
+		0, Function::Variadic,
 		{
 			size_t count = 0;
 			for (auto it = begin; it != end; ++it) {
@@ -87,15 +69,26 @@ void Environment::loadCollectionModify()
 				count += collection->size();
 			}
 
-			auto result_nodes = ValueVector(count);
+			// Skip the leading empty collections
+			while (begin != end && valueCast<Collection>(*begin)->empty()) {
+				begin++;
+			}
+			if (begin == end) {
+				return makePtr<List>();
+			}
+
+			// The other nodes are added to the end of the first collection,
+			// which is shared instead of copied when its buffer has room
+			auto first = valueCast<Collection>(*begin);
+			auto result_nodes = ValueVector(count - first->size());
 			size_t offset = 0;
-			for (auto it = begin; it != end; ++it) {
-				const auto& collection_nodes = std::static_pointer_cast<Collection>(*it)->nodesRead();
+			for (auto it = begin + 1; it != end; ++it) {
+				const auto& collection_nodes = valueCast<Collection>(*it)->nodesRead();
 				std::copy(collection_nodes.begin(), collection_nodes.end(), result_nodes.begin() + offset);
 				offset += collection_nodes.size();
 			}
 
-			return makePtr<List>(result_nodes);
+			return first->concat(result_nodes);
 		});
 
 	// (conj '(1 2 3) 4 5 6) -> (6 5 4 1 2 3)
@@ -104,29 +97,19 @@ void Environment::loadCollectionModify()
 		"conj",
 		"",
 		"",
+		1, Function::Variadic,
 		{
-			CHECK_ARG_COUNT_AT_LEAST("conj", SIZE(), 1);
-
 			VALUE_CAST(collection, Collection, (*begin));
 			begin++;
 
-			const auto& collection_nodes = collection->nodesRead();
-			size_t collection_count = collection_nodes.size();
-			size_t argument_count = SIZE();
-
-			auto nodes = ValueVector(argument_count + collection_count);
-
-			if (is<List>(collection.get())) {
-				std::reverse_copy(begin, end, nodes.begin());
-				std::copy(collection_nodes.begin(), collection_nodes.end(), nodes.begin() + argument_count);
-
-				return makePtr<List>(nodes);
+			if (is<Vector>(collection)) {
+				return valueCast<Vector>(collection)->conj(ValueSpan(begin, end));
 			}
 
-			std::copy(collection_nodes.begin(), collection_nodes.end(), nodes.begin());
-			std::copy(begin, end, nodes.begin() + collection_count);
+			// Every node is added to the front, so the last one ends up first
+			auto nodes = ValueVector(std::make_reverse_iterator(end), std::make_reverse_iterator(begin));
 
-			return makePtr<Vector>(nodes);
+			return collection->cons(nodes);
 		});
 
 	// (map (fn* (x) (* x 2)) (list 1 2 3)) -> (2 4 6)
@@ -134,26 +117,19 @@ void Environment::loadCollectionModify()
 		"map",
 		"",
 		"",
+		2, 2,
 		{
-			CHECK_ARG_COUNT_IS("map", SIZE(), 2);
-
 			VALUE_CAST(callable, Callable, (*begin));
 			VALUE_CAST(collection, Collection, (*(begin + 1)));
 
 			size_t count = collection->size();
 			auto nodes = ValueVector(count);
 
-			if (is<Function>(callable.get())) {
-				auto function = std::static_pointer_cast<Function>(callable)->function();
-				for (size_t i = 0; i < count; ++i) {
-					nodes.at(i) = function(collection->begin() + i, collection->begin() + i + 1);
-				}
-			}
-			else {
-				auto lambda = std::static_pointer_cast<Lambda>(callable);
-				auto collection_nodes = collection->nodesRead();
-				for (size_t i = 0; i < count; ++i) {
-					nodes.at(i) = (Repl::eval(lambda->body(), Environment::create(lambda, { collection_nodes[i] })));
+			const auto& collection_nodes = collection->nodesRead();
+			for (size_t i = 0; i < count; ++i) {
+				nodes.at(i) = Repl::apply(callable, { collection_nodes[i] });
+				if (nodes.at(i) == nullptr) {
+					return nullptr;
 				}
 			}
 
@@ -165,15 +141,14 @@ void Environment::loadCollectionModify()
 		"set-nth",
 		"",
 		"",
+		3, 3,
 		{
-			CHECK_ARG_COUNT_IS("set-nth-element", SIZE(), 3);
-
 			VALUE_CAST(collection, Collection, (*begin));
 
 			VALUE_CAST(number_node, Number, (*(begin + 1)));
 			auto index = static_cast<size_t>(number_node->number() < 0 ? 0 : number_node->number());
 
-			auto value = *(begin + 2);
+			const auto& value = *(begin + 2);
 
 			auto collection_nodes = collection->nodesCopy();
 			if (index >= collection->size()) { // Enlarge list if index out of bounds
@@ -181,11 +156,11 @@ void Environment::loadCollectionModify()
 			}
 			collection_nodes[index] = value;
 
-			if (is<Vector>(begin->get())) {
-				return makePtr<Vector>(collection_nodes);
+			if (is<Vector>(*begin)) {
+				return makePtr<Vector>(std::move(collection_nodes));
 			}
 
-			return makePtr<List>(collection_nodes);
+			return makePtr<List>(std::move(collection_nodes));
 		});
 
 	// (seq '(1 2 3)) -> (1 2 3)
@@ -195,30 +170,28 @@ void Environment::loadCollectionModify()
 		"seq",
 		"",
 		"",
+		1, 1,
 		{
-			CHECK_ARG_COUNT_IS("seq", SIZE(), 1);
+			const auto& front = *begin;
 
-			auto front = *begin;
-			Value* front_raw_ptr = front.get();
-
-			if (is<Constant>(front_raw_ptr) && std::static_pointer_cast<Constant>(front)->state() == Constant::Nil) {
+			if (is<Constant>(front) && valueCast<Constant>(front)->state() == Constant::Nil) {
 				return makePtr<Constant>();
 			}
-			if (is<Collection>(front_raw_ptr)) {
-				auto collection = std::static_pointer_cast<Collection>(front);
+			if (is<Collection>(front)) {
+				auto collection = valueCast<Collection>(front);
 
 				if (collection->empty()) {
 					return makePtr<Constant>();
 				}
 
-				if (is<List>(front_raw_ptr)) {
+				if (is<List>(front)) {
 					return front;
 				}
 
-				return makePtr<List>(collection->nodesCopy());
+				return collection->toList();
 			}
-			if (is<String>(front_raw_ptr)) {
-				auto string = std::static_pointer_cast<String>(front);
+			if (is<String>(front)) {
+				auto string = valueCast<String>(front);
 
 				if (string->empty()) {
 					return makePtr<Constant>();
@@ -247,9 +220,8 @@ void Environment::loadCollectionModify()
 		"assoc",
 		"",
 		"",
+		1, Function::Variadic,
 		{
-			CHECK_ARG_COUNT_AT_LEAST("assoc", SIZE(), 1);
-
 			VALUE_CAST(hash_map, HashMap, (*begin));
 			begin++;
 
@@ -258,7 +230,7 @@ void Environment::loadCollectionModify()
 			Elements elements(hash_map->elements());
 			for (auto it = begin; it != end; std::advance(it, 2)) {
 				const ValuePtr& value = *(std::next(it)); // temporary instance to get around const
-				elements.insert_or_assign(HashMap::getKeyString(*it), value);
+				elements.insert_or_assign(*it, value);
 			}
 
 			return makePtr<HashMap>(elements);
@@ -269,15 +241,14 @@ void Environment::loadCollectionModify()
 		"dissoc",
 		"",
 		"",
+		1, Function::Variadic,
 		{
-			CHECK_ARG_COUNT_AT_LEAST("dissoc", SIZE(), 1);
-
 			VALUE_CAST(hash_map, HashMap, (*begin));
 			begin++;
 
 			Elements elements(hash_map->elements());
 			for (auto it = begin; it != end; ++it) {
-				elements.erase(HashMap::getKeyString(*it));
+				elements.erase(*it);
 			}
 
 			return makePtr<HashMap>(elements);
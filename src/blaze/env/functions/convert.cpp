@@ -21,17 +21,16 @@ void Environment::loadConvert()
 		"number-to-string",
 		"",
 		"",
+		1, 1,
 		{
-			CHECK_ARG_COUNT_IS("number-to-string", SIZE(), 1);
-
 			IS_VALUE(Numeric, (*begin));
 
 			char result[32];
 			auto conversion = std::to_chars(result,
 		                                    result + sizeof(result),
-		                                    is<Number>(begin->get())
-		                                        ? std::static_pointer_cast<Number>(*begin)->number()
-		                                        : std::static_pointer_cast<Decimal>(*begin)->decimal());
+		                                    is<Number>(*begin)
+		                                        ? valueCast<Number>(*begin)->number()
+		                                        : valueCast<Decimal>(*begin)->decimal());
 			if (conversion.ec != std::errc()) {
 				return makePtr<Constant>(Constant::Nil);
 			}
@@ -44,9 +43,8 @@ void Environment::loadConvert()
 		"string-to-char",
 		"",
 		"",
+		1, 1,
 		{
-			CHECK_ARG_COUNT_IS("string-to-char", SIZE(), 1);
-
 			VALUE_CAST(string_value, String, (*begin));
 			std::string data = string_value->data();
 
@@ -58,9 +56,8 @@ void Environment::loadConvert()
 		"string-to-number",
 		"",
 		"",
+		1, 1,
 		{
-			CHECK_ARG_COUNT_IS("string-to-number", SIZE(), 1);
-
 			VALUE_CAST(string_value, String, (*begin));
 			std::string data = string_value->data();
 
@@ -83,10 +80,8 @@ void Environment::loadConvert()
 			return makePtr<Decimal>(decimal);
 		});
 
-#define STRING_TO_COLLECTION(name, type)                    \
+#define STRING_TO_COLLECTION(type)                          \
 	{                                                       \
-		CHECK_ARG_COUNT_IS(name, SIZE(), 1);                \
-                                                            \
 		VALUE_CAST(string_value, String, (*begin));         \
 		std::string data = string_value->data();            \
                                                             \
@@ -100,8 +95,8 @@ void Environment::loadConvert()
 
 	// (string-to-list "foo")   -> (102 111 111)
 	// (string-to-vector "foo") -> [102 111 111]
-	ADD_FUNCTION("string-to-list", "", "", STRING_TO_COLLECTION("string-to-list", List));
-	ADD_FUNCTION("string-to-vector", "", "", STRING_TO_COLLECTION("string-to-vector", Vector));
+	ADD_FUNCTION("string-to-list", "", "", 1, 1, STRING_TO_COLLECTION(List));
+	ADD_FUNCTION("string-to-vector", "", "", 1, 1, STRING_TO_COLLECTION(Vector));
 
 	// -------------------------------------
 
@@ -110,16 +105,15 @@ void Environment::loadConvert()
 		"symbol",
 		"",
 		"",
+		1, 1,
 		{
-			CHECK_ARG_COUNT_IS("symbol", SIZE(), 1);
-
-			if (is<Symbol>(begin->get())) {
+			if (is<Symbol>(*begin)) {
 				return *begin;
 			}
 
 			VALUE_CAST(string_value, String, (*begin));
 
-			return makePtr<Symbol>(string_value->data());
+			return Symbol::create(string_value->data());
 		});
 
 	// (keyword "foo") -> :foo
@@ -128,21 +122,20 @@ void Environment::loadConvert()
 		"keyword",
 		"",
 		"",
+		1, 1,
 		{
-			CHECK_ARG_COUNT_IS("keyword", SIZE(), 1);
-
-			if (is<Keyword>(begin->get())) {
+			if (is<Keyword>(*begin)) {
 				return *begin;
 			}
-			else if (is<Number>(begin->get())) {
+			else if (is<Number>(*begin)) {
 				VALUE_CAST(number_value, Number, (*begin));
 
-				return makePtr<Keyword>(number_value->number());
+				return Keyword::create(number_value->number());
 			}
 
 			VALUE_CAST(string_value, String, (*begin));
 
-			return makePtr<Keyword>(string_value->data());
+			return Keyword::create(string_value->data());
 		});
 }
 
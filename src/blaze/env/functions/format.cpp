@@ -35,8 +35,8 @@ void Environment::loadFormat()
 		return makePtr<String>(result);                                               \
 	}
 
-	ADD_FUNCTION("str", "", "", PRINTER_STRING(false, ""));
-	ADD_FUNCTION("pr-str", "", "", PRINTER_STRING(true, " "));
+	ADD_FUNCTION("str", "", "", 0, Function::Variadic, PRINTER_STRING(false, ""));
+	ADD_FUNCTION("pr-str", "", "", 0, Function::Variadic, PRINTER_STRING(true, " "));
 
 #define PRINTER_PRINT(print_readably)                                    \
 	{                                                                    \
@@ -53,8 +53,8 @@ void Environment::loadFormat()
 		return makePtr<Constant>();                                      \
 	}
 
-	ADD_FUNCTION("prn", "", "", PRINTER_PRINT(true));
-	ADD_FUNCTION("println", "", "", PRINTER_PRINT(false));
+	ADD_FUNCTION("prn", "", "", 0, Function::Variadic, PRINTER_PRINT(true));
+	ADD_FUNCTION("println", "", "", 0, Function::Variadic, PRINTER_PRINT(false));
 
 	// -------------------------------------
 
@@ -62,9 +62,8 @@ void Environment::loadFormat()
 		"dump",
 		"arg",
 		"Print AST of the value ARG.",
+		1, 1,
 		{
-			CHECK_ARG_COUNT_IS("dump", SIZE(), 1);
-
 			Reader reader;
 			reader.dump(*begin);
 
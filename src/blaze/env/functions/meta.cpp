@@ -19,15 +19,13 @@ void Environment::loadMeta()
 		"meta",
 		"",
 		"",
+		1, 1,
 		{
-			CHECK_ARG_COUNT_IS("meta", SIZE(), 1);
+			const auto& front = *begin;
 
-			auto front = *begin;
-			Value* front_raw_ptr = begin->get();
-
-			if (!is<Collection>(front_raw_ptr) && // List / Vector
-		        !is<HashMap>(front_raw_ptr) &&    // HashMap
-		        !is<Callable>(front_raw_ptr)) {   // Function / Lambda
+			if (!is<Collection>(front) && // List / Vector
+		        !is<HashMap>(front) &&    // HashMap
+		        !is<Callable>(front)) {   // Function / Lambda
 				Error::the().add(::format("wrong argument type: Collection, HashMap or Callable, {}", front));
 				return nullptr;
 			}
@@ -40,15 +38,13 @@ void Environment::loadMeta()
 		"with-meta",
 		"",
 		"",
+		2, 2,
 		{
-			CHECK_ARG_COUNT_IS("with-meta", SIZE(), 2);
-
-			auto front = *begin;
-			Value* front_raw_ptr = begin->get();
+			const auto& front = *begin;
 
-			if (!is<Collection>(front_raw_ptr) && // List / Vector
-		        !is<HashMap>(front_raw_ptr) &&    // HashMap
-		        !is<Callable>(front_raw_ptr)) {   // Function / Lambda
+			if (!is<Collection>(front) && // List / Vector
+		        !is<HashMap>(front) &&    // HashMap
+		        !is<Callable>(front)) {   // Function / Lambda
 				Error::the().add(::format("wrong argument type: Collection, HashMap or Callable, {}", front));
 				return nullptr;
 			}
@@ -5,7 +5,7 @@
  */
 
 #include <algorithm> // std::copy
-#include <memory>    // std::static_pointer_cast
+#include <utility>   // std::move
 
 #include "blaze/ast.h"
 #include "blaze/env/environment.h"
@@ -23,9 +23,8 @@ void Environment::loadMutable()
 		"atom",
 		"",
 		"",
+		1, 1,
 		{
-			CHECK_ARG_COUNT_IS("atom", SIZE(), 1);
-
 			return makePtr<Atom>(*begin);
 		});
 
@@ -34,9 +33,8 @@ void Environment::loadMutable()
 		"deref",
 		"",
 		"",
+		1, 1,
 		{
-			CHECK_ARG_COUNT_IS("deref", SIZE(), 1);
-
 			VALUE_CAST(atom, Atom, (*begin));
 
 			return atom->deref();
@@ -47,11 +45,10 @@ void Environment::loadMutable()
 		"reset!",
 		"",
 		"",
+		2, 2,
 		{
-			CHECK_ARG_COUNT_IS("reset!", SIZE(), 2);
-
 			VALUE_CAST(atom, Atom, (*begin));
-			auto value = *(begin + 1);
+			const auto& value = *(begin + 1);
 
 			atom->reset(value);
 
@@ -63,9 +60,8 @@ void Environment::loadMutable()
 		"swap!",
 		"",
 		"",
+		2, Function::Variadic,
 		{
-			CHECK_ARG_COUNT_AT_LEAST("swap!", SIZE(), 2);
-
 			VALUE_CAST(atom, Atom, (*begin));
 
 			VALUE_CAST(callable, Callable, (*(begin + 1)));
@@ -76,17 +72,12 @@ void Environment::loadMutable()
 			arguments[0] = atom->deref();
 			std::copy(begin, end, arguments.begin() + 1);
 
-			ValuePtr value = nullptr;
-			if (is<Function>(callable.get())) {
-				auto function = std::static_pointer_cast<Function>(callable)->function();
-				value = function(arguments.begin(), arguments.end());
-			}
-			else {
-				auto lambda = std::static_pointer_cast<Lambda>(callable);
-				value = Repl::eval(lambda->body(), Environment::create(lambda, std::move(arguments)));
+			ValuePtr value = Repl::apply(callable, std::move(arguments));
+			if (value == nullptr) {
+				return nullptr;
 			}
 
-			return atom->reset(value);
+			return atom->reset(std::move(value));
 		});
 }
 
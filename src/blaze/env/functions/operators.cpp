@@ -5,7 +5,6 @@
  */
 
 #include <cstdint> // int64_t
-#include <memory>  // std::static_pointer_cast
 
 #include "blaze/ast.h"
 #include "blaze/env/macro.h"
@@ -17,15 +16,15 @@ void Environment::loadOperators()
 {
 #define APPLY_NUMBER_OR_DECIMAL(it, apply)                                   \
 	IS_VALUE(Numeric, (*it));                                                \
-	if (is<Number>(it->get())) {                                             \
-		auto it_numeric = std::static_pointer_cast<Number>(*it)->number();   \
+	if (is<Number>(*it)) {                                             \
+		auto it_numeric = valueCast<Number>(*it)->number();   \
 		do {                                                                 \
 			apply                                                            \
 		} while (0);                                                         \
 	}                                                                        \
 	else {                                                                   \
 		return_decimal = true;                                               \
-		auto it_numeric = std::static_pointer_cast<Decimal>(*it)->decimal(); \
+		auto it_numeric = valueCast<Decimal>(*it)->decimal(); \
 		do {                                                                 \
 			apply                                                            \
 		} while (0);                                                         \
@@ -41,6 +40,7 @@ void Environment::loadOperators()
 		"+",
 		"number...",
 		"Return the sum of any amount of arguments, where NUMBER is of type number.",
+		0, Function::Variadic,
 		{
 			bool return_decimal = false;
 
@@ -64,6 +64,7 @@ void Environment::loadOperators()
 
 With one arg, negates it. With more than one arg,
 subtracts all but the first from the first.)",
+		0, Function::Variadic,
 		{
 			size_t length = SIZE();
 			if (length == 0) {
@@ -103,6 +104,7 @@ subtracts all but the first from the first.)",
 		"*",
 		"",
 		"",
+		0, Function::Variadic,
 		{
 			bool return_decimal = false;
 
@@ -123,9 +125,8 @@ subtracts all but the first from the first.)",
 		"/",
 		"",
 		"",
+		1, Function::Variadic,
 		{
-			CHECK_ARG_COUNT_AT_LEAST("/", SIZE(), 1);
-
 			bool return_decimal = false;
 
 			int64_t number = 0;
@@ -153,9 +154,8 @@ subtracts all but the first from the first.)",
 		"%",
 		"",
 		"",
+		2, 2,
 		{
-			CHECK_ARG_COUNT_IS("/", SIZE(), 2);
-
 			VALUE_CAST(divide, Number, (*begin));
 			VALUE_CAST(by, Number, (*(begin + 1)));
 
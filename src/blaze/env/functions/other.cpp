@@ -11,9 +11,12 @@
 #include "ruc/file.h"
 
 #include "blaze/ast.h"
+#include "blaze/collector.h"
 #include "blaze/env/macro.h"
 #include "blaze/error.h"
+#include "blaze/eval.h"
 #include "blaze/forward.h"
+#include "blaze/pool.h"
 #include "blaze/util.h"
 
 namespace blaze {
@@ -23,9 +26,8 @@ void Environment::loadOther()
 	ADD_FUNCTION(
 		"pwd", "",
 		"Return the full filename of the current working directory.",
+		0, 0,
 		{
-			CHECK_ARG_COUNT_IS("pwd", SIZE(), 0);
-
 			auto path = std::filesystem::current_path().string();
 			return makePtr<String>(path);
 		});
@@ -33,9 +35,8 @@ void Environment::loadOther()
 	ADD_FUNCTION(
 		"slurp", "",
 		"Read file contents",
+		1, 1,
 		{
-			CHECK_ARG_COUNT_IS("slurp", SIZE(), 1);
-
 			VALUE_CAST(node, String, (*begin));
 			std::string path = node->data();
 
@@ -50,9 +51,8 @@ void Environment::loadOther()
 	ADD_FUNCTION(
 		"throw", "",
 		"",
+		1, 1,
 		{
-			CHECK_ARG_COUNT_IS("throw", SIZE(), 1);
-
 			Error::the().add(*begin);
 
 			return nullptr;
@@ -64,15 +64,50 @@ void Environment::loadOther()
 	ADD_FUNCTION(
 		"time-ms", "",
 		"",
+		0, 0,
 		{
-			CHECK_ARG_COUNT_IS("time-ms", SIZE(), 0);
-
 			int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
 								  std::chrono::system_clock::now().time_since_epoch())
 		                          .count();
 
 			return makePtr<Number>(elapsed);
 		});
+
+	ADD_FUNCTION(
+		"macro-cache-hits", "",
+		"Return the number of macro calls that reused the expansion cached at their call site.",
+		0, 0,
+		{
+			return makePtr<Number>(static_cast<int64_t>(Eval::expansionsSaved()));
+		});
+
+	// -----------------------------------------
+
+	// (gc)
+	ADD_FUNCTION(
+		"gc", "",
+		"Free the closures, environments and atoms that only reference each other, return how many objects were freed.",
+		0, 0,
+		{
+			return makePtr<Number>(static_cast<int64_t>(Collector::collect()));
+		});
+
+	// (pool-stats)
+	ADD_FUNCTION(
+		"pool-stats", "",
+		"Return the allocations served from a free list, the ones that were not and the bytes held for reuse, as a hash-map.",
+		0, 0,
+		{
+			auto stats = Pool::stats();
+
+			Elements elements;
+			elements.insert_or_assign(Keyword::create("hits"), makePtr<Number>(static_cast<int64_t>(stats.hits)));
+			elements.insert_or_assign(Keyword::create("misses"), makePtr<Number>(static_cast<int64_t>(stats.misses)));
+			elements.insert_or_assign(Keyword::create("retained"), makePtr<Number>(static_cast<int64_t>(stats.retained)));
+			elements.insert_or_assign(Keyword::create("slabs"), makePtr<Number>(static_cast<int64_t>(stats.slabs)));
+
+			return makePtr<HashMap>(elements);
+		});
 }
 
 } // namespace blaze
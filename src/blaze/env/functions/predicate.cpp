@@ -12,19 +12,17 @@ namespace blaze {
 
 void Environment::loadPredicate()
 {
-#define IS_CONSTANT(name, constant)                                              \
+#define IS_CONSTANT(constant)                                                    \
 	{                                                                            \
-		CHECK_ARG_COUNT_IS(name, SIZE(), 1);                                     \
-                                                                                 \
 		return makePtr<Constant>(                                                \
-			is<Constant>(begin->get())                                           \
-			&& std::static_pointer_cast<Constant>(*begin)->state() == constant); \
+			is<Constant>(*begin)                                           \
+			&& valueCast<Constant>(*begin)->state() == constant); \
 	}
 
 	// (nil? nil)
-	ADD_FUNCTION("nil?", "", "", IS_CONSTANT("nil?", Constant::Nil));
-	ADD_FUNCTION("true?", "", "", IS_CONSTANT("true?", Constant::True));
-	ADD_FUNCTION("false?", "", "", IS_CONSTANT("false?", Constant::False));
+	ADD_FUNCTION("nil?", "", "", 1, 1, IS_CONSTANT(Constant::Nil));
+	ADD_FUNCTION("true?", "", "", 1, 1, IS_CONSTANT(Constant::True));
+	ADD_FUNCTION("false?", "", "", 1, 1, IS_CONSTANT(Constant::False));
 
 	// -----------------------------------------
 
@@ -37,7 +35,7 @@ void Environment::loadPredicate()
 		}                                        \
                                                  \
 		for (auto it = begin; it != end; ++it) { \
-			if (!is<type>(it->get())) {          \
+			if (!is<type>(*it)) {          \
 				result = false;                  \
 				break;                           \
 			}                                    \
@@ -47,20 +45,21 @@ void Environment::loadPredicate()
 	}
 
 	// (symbol? 'foo)
-	ADD_FUNCTION("atom?", "", "", IS_TYPE(Atom));
-	ADD_FUNCTION("keyword?", "", "", IS_TYPE(Keyword));
-	ADD_FUNCTION("list?", "", "", IS_TYPE(List));
-	ADD_FUNCTION("map?", "", "", IS_TYPE(HashMap));
-	ADD_FUNCTION("number?", "", "", IS_TYPE(Number));
-	ADD_FUNCTION("sequential?", "", "", IS_TYPE(Collection));
-	ADD_FUNCTION("string?", "", "", IS_TYPE(String));
-	ADD_FUNCTION("symbol?", "", "", IS_TYPE(Symbol));
-	ADD_FUNCTION("vector?", "", "", IS_TYPE(Vector));
+	ADD_FUNCTION("atom?", "", "", 0, Function::Variadic, IS_TYPE(Atom));
+	ADD_FUNCTION("keyword?", "", "", 0, Function::Variadic, IS_TYPE(Keyword));
+	ADD_FUNCTION("list?", "", "", 0, Function::Variadic, IS_TYPE(List));
+	ADD_FUNCTION("map?", "", "", 0, Function::Variadic, IS_TYPE(HashMap));
+	ADD_FUNCTION("number?", "", "", 0, Function::Variadic, IS_TYPE(Number));
+	ADD_FUNCTION("sequential?", "", "", 0, Function::Variadic, IS_TYPE(Collection));
+	ADD_FUNCTION("string?", "", "", 0, Function::Variadic, IS_TYPE(String));
+	ADD_FUNCTION("symbol?", "", "", 0, Function::Variadic, IS_TYPE(Symbol));
+	ADD_FUNCTION("vector?", "", "", 0, Function::Variadic, IS_TYPE(Vector));
 
 	ADD_FUNCTION(
 		"fn?",
 		"",
 		"",
+		0, Function::Variadic,
 		{
 			bool result = true;
 
@@ -69,7 +68,7 @@ void Environment::loadPredicate()
 			}
 
 			for (auto it = begin; it != end; ++it) {
-				if (!is<Callable>(it->get()) || is<Macro>(it->get())) {
+				if (!is<Callable>(*it) || is<Macro>(*it)) {
 					result = false;
 					break;
 				}
@@ -82,6 +81,7 @@ void Environment::loadPredicate()
 		"macro?",
 		"",
 		"",
+		0, Function::Variadic,
 		{
 			bool result = true;
 
@@ -90,7 +90,7 @@ void Environment::loadPredicate()
 			}
 
 			for (auto it = begin; it != end; ++it) {
-				if (!is<Macro>(it->get())) {
+				if (!is<Macro>(*it)) {
 					result = false;
 					break;
 				}
@@ -107,9 +107,8 @@ void Environment::loadPredicate()
 		"contains?",
 		"",
 		"",
+		2, 2,
 		{
-			CHECK_ARG_COUNT_IS("contains?", SIZE(), 2);
-
 			VALUE_CAST(hash_map, HashMap, (*begin));
 
 			if (SIZE() == 0) {
@@ -125,6 +124,7 @@ void Environment::loadPredicate()
 		"empty?",
 		"",
 		"",
+		0, Function::Variadic,
 		{
 			bool result = true;
 
@@ -20,9 +20,8 @@ void Environment::loadRepl()
 		"read-string",
 		"",
 		"",
+		1, 1,
 		{
-			CHECK_ARG_COUNT_IS("read-string", SIZE(), 1);
-
 			VALUE_CAST(node, String, (*begin));
 			std::string input = node->data();
 
@@ -34,9 +33,8 @@ void Environment::loadRepl()
 		"readline",
 		"",
 		"",
+		1, 1,
 		{
-			CHECK_ARG_COUNT_IS("readline", SIZE(), 1);
-
 			VALUE_CAST(prompt, String, (*begin));
 
 			return Repl::readline(prompt->data());
@@ -47,9 +45,8 @@ void Environment::loadRepl()
 		"eval",
 		"",
 		"",
+		1, 1,
 		{
-			CHECK_ARG_COUNT_IS("eval", SIZE(), 1);
-
 			return Repl::eval(*begin, nullptr);
 		});
 }
@@ -12,11 +12,19 @@
 #include "blaze/env/environment.h"
 #include "blaze/forward.h"
 
-#define ADD_FUNCTION(name, signature, documentation, lambda) \
-	blaze::Environment::registerFunction(                    \
-		{ name,                                              \
-	      signature,                                         \
-	      documentation,                                     \
-	      [](blaze::ValueVectorConstIt begin, blaze::ValueVectorConstIt end) -> blaze::ValuePtr lambda });
+// The argument count is checked against min and max before the call, use
+// Function::Variadic as max for any number of arguments
+#define ADD_FUNCTION(name, signature, documentation, min, max, lambda) \
+	blaze::Environment::registerFunction(                              \
+		{ name,                                                        \
+	      signature,                                                   \
+	      documentation,                                               \
+	      min,                                                         \
+	      max,                                                         \
+	      [](blaze::ValueSpan arguments) -> blaze::ValuePtr {          \
+		      [[maybe_unused]] auto begin = arguments.begin();         \
+		      [[maybe_unused]] auto end = arguments.end();             \
+		      lambda                                                   \
+	      } });
 
 #define SIZE() std::distance(begin, end)
@@ -6,11 +6,12 @@
 
 #include <algorithm> // std::find_if, std::transform
 #include <cctype>    // std::toupper
-#include <iterator>  // std::distance, std::next, std::prev
-#include <list>
-#include <memory>
-#include <span>
+#include <cstdint>   // uint32_t
+#include <iterator>  // std::advance, std::next, std::prev
+#include <memory>    // std::make_shared
 #include <string>
+#include <utility> // std::move, std::pair
+#include <vector>
 
 #include "ruc/format/color.h"
 #include "ruc/format/format.h"
@@ -29,28 +30,99 @@
 
 namespace blaze {
 
-static ValuePtr evalQuasiQuoteImpl(ValuePtr ast);
+static bool isTruthy(const ValuePtr& value)
+{
+	return !is<Constant>(value) || valueCast<Constant>(value)->state() == Constant::True;
+}
+
+static std::vector<ExecutablePtr> analyzeSequence(ValueSpanIt begin, ValueSpanIt end, const ScopePtr& scope)
+{
+	std::vector<ExecutablePtr> result;
+	result.reserve(std::distance(begin, end));
+	for (auto it = begin; it != end; ++it) {
+		auto executable = Eval::analyze(*it, scope, false);
+		if (executable == nullptr) {
+			return {};
+		}
+		result.push_back(std::move(executable));
+	}
+
+	return result;
+}
+
+// -----------------------------------------
+
+namespace {
+
+class DefNode final : public Executable {
+public:
+	DefNode(uint32_t symbol, ExecutablePtr value)
+		: m_symbol(symbol)
+		, m_value(std::move(value))
+	{
+	}
+
+	virtual ValuePtr execute(const EnvironmentPtr& env) override
+	{
+		ValuePtr value = m_value->execute(env);
+
+		// Dont overwrite symbols after an error
+		if (Error::the().hasAnyError()) {
+			return nullptr;
+		}
+
+		// Modify existing environment
+		return env->set(m_symbol, std::move(value));
+	}
+
+private:
+	const uint32_t m_symbol { 0 };
+	const ExecutablePtr m_value;
+};
+
+class DefMacroNode final : public Executable {
+public:
+	DefMacroNode(uint32_t symbol, ExecutablePtr value)
+		: m_symbol(symbol)
+		, m_value(std::move(value))
+	{
+	}
+
+	virtual ValuePtr execute(const EnvironmentPtr& env) override
+	{
+		ValuePtr value = m_value->execute(env);
+		VALUE_CAST(lambda, Lambda, value);
+
+		// Dont overwrite symbols after an error
+		if (Error::the().hasAnyError()) {
+			return nullptr;
+		}
+
+		// Modify existing environment
+		return env->set(m_symbol, makePtr<Macro>(*lambda));
+	}
+
+private:
+	const uint32_t m_symbol { 0 };
+	const ExecutablePtr m_value;
+};
+
+} // namespace
 
 EVAL_FUNCTION("def!", "symbol value", "Set SYMBOL to the value VALUE.");
-ValuePtr Eval::evalDef(const ValueVector& nodes, EnvironmentPtr env)
+ExecutablePtr Eval::analyzeDef(ValueSpan nodes, const ScopePtr& scope)
 {
 	CHECK_ARG_COUNT_IS("def!", nodes.size(), 2);
 
 	// First argument needs to be a Symbol
 	VALUE_CAST(symbol, Symbol, nodes.front());
 
-	// Eval second argument
-	m_ast = *std::next(nodes.begin());
-	m_env = env;
-	ValuePtr value = evalImpl();
-
-	// Dont overwrite symbols after an error
-	if (Error::the().hasAnyError()) {
+	auto value = analyze(*std::next(nodes.begin()), scope, false);
+	if (value == nullptr) {
 		return nullptr;
 	}
 
-	// Modify existing environment
-	return env->set(symbol->symbol(), value);
+	return std::make_shared<DefNode>(symbol->id(), value);
 }
 
 EVAL_FUNCTION("defmacro!", "symbol function",
@@ -60,154 +132,199 @@ When the macro is called, as in (NAME ARGS...),
 the FUNCTION (fn* ARGLIST BODY...) is applied to
 the list ARGS... as it appears in the expression,
 and the result should be a form to be evaluated instead of the original.)");
-ValuePtr Eval::evalDefMacro(const ValueVector& nodes, EnvironmentPtr env)
+ExecutablePtr Eval::analyzeDefMacro(ValueSpan nodes, const ScopePtr& scope)
 {
 	CHECK_ARG_COUNT_IS("defmacro!", nodes.size(), 2);
 
 	// First argument needs to be a Symbol
 	VALUE_CAST(symbol, Symbol, nodes.front());
 
-	// Eval second argument
-	m_ast = *std::next(nodes.begin());
-	m_env = env;
-	ValuePtr value = evalImpl();
-	VALUE_CAST(lambda, Lambda, value);
-
-	// Dont overwrite symbols after an error
-	if (Error::the().hasAnyError()) {
+	auto value = analyze(*std::next(nodes.begin()), scope, false);
+	if (value == nullptr) {
 		return nullptr;
 	}
 
-	// Modify existing environment
-	return env->set(symbol->symbol(), makePtr<Macro>(*lambda));
+	return std::make_shared<DefMacroNode>(symbol->id(), value);
 }
 
-EVAL_FUNCTION("describe", "symbol", "Display the full documentation of SYMBOL.");
-ValuePtr Eval::evalDescribe(const ValueVector& nodes, EnvironmentPtr env)
-{
-	CHECK_ARG_COUNT_IS("describe", nodes.size(), 1);
+// -----------------------------------------
 
-	// First argument needs to be a Symbol
-	VALUE_CAST(symbol, Symbol, nodes.front());
-	auto symbol_string = symbol->symbol();
+namespace {
 
-	std::string type;
-	std::string signature;
-	std::string documentation;
-	std::string value_string;
+class DescribeNode final : public Executable {
+public:
+	DescribeNode(ValuePtr symbol)
+		: m_symbol(std::move(symbol))
+	{
+	}
 
-	bool pretty_print = Settings::the().getEnvBool("*PRETTY-PRINT*");
-	auto bold = fg(ruc::format::TerminalColor::None) | ruc::format::Emphasis::Bold;
+	virtual ValuePtr execute(const EnvironmentPtr& env) override
+	{
+		const auto& special_form_parts = Eval::specialFormParts();
+		auto symbol_string = valueCast<Symbol>(m_symbol)->symbol();
 
-	auto describe = [&]() {
-		print("{} is a {}.\n\n", symbol_string, type);
+		std::string type;
+		std::string signature;
+		std::string documentation;
+		std::string value_string;
 
-		if (!signature.empty()) {
-			pretty_print ? print(bold, "Signature\n") : print("Signature\n");
-			print("({})\n", signature);
-		}
+		bool pretty_print = Settings::the().getEnvBool("*PRETTY-PRINT*");
+		auto bold = fg(ruc::format::TerminalColor::None) | ruc::format::Emphasis::Bold;
 
-		if (!documentation.empty()) {
-			pretty_print ? print(bold, "\nDocumentation\n") : print("\nDocumentation\n");
-			print("{}\n", documentation);
-		}
+		auto describe = [&]() {
+			print("{} is a {}.\n\n", symbol_string, type);
 
-		if (!value_string.empty()) {
-			pretty_print ? print(bold, "Value\n") : print("Value\n");
-			print("{}\n", value_string);
+			if (!signature.empty()) {
+				pretty_print ? print(bold, "Signature\n") : print("Signature\n");
+				print("({})\n", signature);
+			}
+
+			if (!documentation.empty()) {
+				pretty_print ? print(bold, "\nDocumentation\n") : print("\nDocumentation\n");
+				print("{}\n", documentation);
+			}
+
+			if (!value_string.empty()) {
+				pretty_print ? print(bold, "Value\n") : print("Value\n");
+				print("{}\n", value_string);
+			}
+		};
+
+		// Verify if symbol is a special form
+		auto special_form = std::find_if(
+			special_form_parts.begin(),
+			special_form_parts.end(),
+			[&symbol_string](const SpecialFormParts& special_form_parts) {
+				return special_form_parts.name == symbol_string;
+			});
+
+		// If symbol is not special form, lookup in the environment
+		ValuePtr value;
+		if (special_form == special_form_parts.end()) {
+			value = env->get(symbol_string);
+			if (!value) {
+				Error::the().add(format("'{}' not found", symbol_string));
+				return nullptr;
+			}
 		}
-	};
-
-	// Verify if symbol is a special form
-	auto special_form = std::find_if(
-		s_special_form_parts.begin(),
-		s_special_form_parts.end(),
-		[&symbol_string](const SpecialFormParts& special_form_parts) {
-			return special_form_parts.name == symbol_string;
-		});
-
-	// If symbol is not special form, lookup in the environment
-	ValuePtr value;
-	if (special_form == s_special_form_parts.end()) {
-		value = env->get(symbol_string);
-		if (!value) {
-			Error::the().add(format("'{}' not found", symbol_string));
+
+		// Variable
+		if (special_form == special_form_parts.end() && !is<Callable>(value)) {
+			type = "variable";
+
+			Printer printer;
+			value_string = format("{}", printer.printNoErrorCheck(value, true));
+
+			describe();
+
 			return nullptr;
 		}
-	}
 
-	// Variable
-	if (special_form == s_special_form_parts.end() && !is<Callable>(value.get())) {
-		type = "variable";
+		signature = pretty_print ? format(fg(ruc::format::TerminalColor::BrightBlue), "{}", symbol_string)
+		                         : symbol_string;
 
-		Printer printer;
-		value_string = format("{}", printer.printNoErrorCheck(value, true));
+		// Special form
+		if (special_form != special_form_parts.end()) {
+			type = "special form";
 
-		describe();
+			std::string signature_lower = std::string(special_form->signature);
+			std::transform(signature_lower.begin(), signature_lower.end(), signature_lower.begin(), ::toupper);
+			signature += !signature_lower.empty() ? " " : "";
+			signature += signature_lower;
 
-		return nullptr;
-	}
+			documentation = special_form->documentation;
+
+			describe();
+
+			return nullptr;
+		}
 
-	signature = pretty_print ? format(fg(ruc::format::TerminalColor::BrightBlue), "{}", symbol_string)
-	                         : symbol_string;
+		// Function / lambda / macro
+		if (is<Function>(value)) {
+			type = "function";
 
-	// Special form
-	if (special_form != s_special_form_parts.end()) {
-		type = "special form";
+			auto function = valueCast<Function>(value);
+			signature += !function->bindings().empty() ? " " : "";
+			signature += function->bindings();
 
-		std::string signature_lower = std::string(special_form->signature);
-		std::transform(signature_lower.begin(), signature_lower.end(), signature_lower.begin(), ::toupper);
-		signature += !signature_lower.empty() ? " " : "";
-		signature += signature_lower;
+			documentation = function->documentation();
+		}
+		else if (is<Lambda>(value) || is<Macro>(value)) {
+			type = is<Lambda>(value) ? "function" : "macro";
+
+			auto lambda = valueCast<Lambda>(value);
+			const auto& bindings = lambda->bindings();
+			std::string binding;
+			for (size_t i = 0; i < bindings.size(); ++i) {
+				binding = Symbol::find(bindings[i])->symbol();
+				std::transform(binding.begin(), binding.end(), binding.begin(), ::toupper);
+				signature += " " + binding;
+			}
 
-		documentation = special_form->documentation;
+			auto body = lambda->body();
+			if (is<String>(body)) {
+				documentation = valueCast<String>(body)->data();
+			}
+			else if (is<List>(body)) {
+				VALUE_CAST(list, List, body);
+				if (list->size() > 1) {
+					auto second = list->nodesRead()[1];
+					if (is<String>(second)) {
+						documentation = valueCast<String>(second)->data();
+					}
+				}
+			}
+		}
 
 		describe();
 
 		return nullptr;
 	}
 
-	// Function / lambda / macro
-	if (is<Function>(value.get())) {
-		type = "function";
+private:
+	const ValuePtr m_symbol;
+};
 
-		auto function = std::static_pointer_cast<Function>(value);
-		signature += !function->bindings().empty() ? " " : "";
-		signature += function->bindings();
+} // namespace
 
-		documentation = function->documentation();
-	}
-	else if (is<Lambda>(value.get()) || is<Macro>(value.get())) {
-		type = is<Lambda>(value.get()) ? "function" : "macro";
+EVAL_FUNCTION("describe", "symbol", "Display the full documentation of SYMBOL.");
+ExecutablePtr Eval::analyzeDescribe(ValueSpan nodes)
+{
+	CHECK_ARG_COUNT_IS("describe", nodes.size(), 1);
 
-		auto lambda = std::static_pointer_cast<Lambda>(value);
-		auto bindings = lambda->bindings();
-		std::string binding;
-		for (size_t i = 0; i < bindings.size(); ++i) {
-			binding = bindings[i];
-			std::transform(binding.begin(), binding.end(), binding.begin(), ::toupper);
-			signature += " " + binding;
-		}
+	// First argument needs to be a Symbol
+	IS_VALUE(Symbol, nodes.front());
 
-		auto body = lambda->body();
-		if (is<String>(body.get())) {
-			documentation = std::static_pointer_cast<String>(body)->data();
-		}
-		else if (is<List>(body.get())) {
-			VALUE_CAST(list, List, body);
-			if (list->size() > 1) {
-				auto second = list->nodesRead()[1];
-				if (is<String>(second.get())) {
-					documentation = std::static_pointer_cast<String>(second)->data();
-				}
-			}
-		}
+	return std::make_shared<DescribeNode>(nodes.front());
+}
+
+// -----------------------------------------
+
+namespace {
+
+class FnNode final : public Executable {
+public:
+	FnNode(std::vector<uint32_t>&& bindings, ScopePtr scope, ValuePtr body, ExecutablePtr executable)
+		: m_bindings(std::move(bindings))
+		, m_scope(std::move(scope))
+		, m_body(std::move(body))
+		, m_executable(std::move(executable))
+	{
+	}
+
+	virtual ValuePtr execute(const EnvironmentPtr& env) override
+	{
+		return makePtr<Lambda>(m_bindings, m_scope, m_body, m_executable, env);
 	}
 
-	describe();
+private:
+	const std::vector<uint32_t> m_bindings;
+	const ScopePtr m_scope;
+	const ValuePtr m_body;
+	const ExecutablePtr m_executable;
+};
 
-	return nullptr;
-}
+} // namespace
 
 EVAL_FUNCTION("fn*", "args [docstring] body...", R"(Return an anonymous function.
 
@@ -215,7 +332,7 @@ ARGS should take the form of an argument list or vector.
 DOCSTRING is an optional documentation string.
  If present, it should describe how to call the function.
 BODY should be a list of Lisp expressions.)");
-ValuePtr Eval::evalFn(const ValueVector& nodes, EnvironmentPtr env)
+ExecutablePtr Eval::analyzeFn(ValueSpan nodes, const ScopePtr& scope)
 {
 	CHECK_ARG_COUNT_AT_LEAST("fn*", nodes.size(), 2);
 
@@ -223,48 +340,136 @@ ValuePtr Eval::evalFn(const ValueVector& nodes, EnvironmentPtr env)
 	VALUE_CAST(collection, Collection, nodes.front());
 	const auto& collection_nodes = collection->nodesRead();
 
-	std::vector<std::string> bindings;
+	std::vector<uint32_t> bindings;
+	std::vector<uint32_t> slots;
 	bindings.reserve(collection_nodes.size());
 	for (const auto& node : collection_nodes) {
 		// All nodes need to be a Symbol
 		VALUE_CAST(symbol, Symbol, node);
-		bindings.push_back(symbol->symbol());
+		bindings.push_back(symbol->id());
+		if (symbol->id() != Symbol::Ampersand) {
+			slots.push_back(symbol->id());
+		}
 	}
 
 	// If more than one s-exp in lambda body, wrap in list
+	ValuePtr body = *std::next(nodes.begin());
 	if (nodes.size() > 2) {
 		auto first = std::next(nodes.begin());
 		auto last = std::prev(nodes.end());
 		auto body_nodes = ValueVector(std::distance(first, last) + 2);
-		body_nodes.at(0) = makePtr<Symbol>("do");
+		body_nodes.at(0) = Symbol::create(Symbol::Do);
 		std::copy(first, nodes.end(), body_nodes.begin() + 1);
-		auto body = makePtr<List>(body_nodes);
+		body = makePtr<List>(body_nodes);
+	}
 
-		return makePtr<Lambda>(bindings, body, env);
+	// The body is analyzed once, every Lambda created from it shares the result
+	auto body_scope = Scope::create(scope, std::move(slots));
+	auto executable = analyze(body, body_scope, true);
+	if (executable == nullptr) {
+		return nullptr;
 	}
 
-	return makePtr<Lambda>(bindings, *std::next(nodes.begin()), env);
+	return std::make_shared<FnNode>(std::move(bindings), body_scope, body, executable);
 }
 
 // -----------------------------------------
 
+namespace {
+
+class QuoteNode final : public Executable {
+public:
+	QuoteNode(ValuePtr value)
+		: m_value(std::move(value))
+	{
+	}
+
+	virtual ValuePtr execute(const EnvironmentPtr&) override { return m_value; }
+
+private:
+	const ValuePtr m_value;
+};
+
+} // namespace
+
 // (quasiquoteexpand x)
 EVAL_FUNCTION("quasiquoteexpand", "arg", ""); // TODO
-ValuePtr Eval::evalQuasiQuoteExpand(const ValueVector& nodes)
+ExecutablePtr Eval::analyzeQuasiQuoteExpand(ValueSpan nodes)
 {
 	CHECK_ARG_COUNT_IS("quasiquoteexpand", nodes.size(), 1);
 
-	return evalQuasiQuoteImpl(nodes.front());
+	auto result = quasiQuote(nodes.front());
+	if (Error::the().hasAnyError()) {
+		return nullptr;
+	}
+
+	return std::make_shared<QuoteNode>(result);
 }
 
 EVAL_FUNCTION("quote", "arg", "Return the ARG, without evaluating it. (quote x) yields x.");
-ValuePtr Eval::evalQuote(const ValueVector& nodes)
+ExecutablePtr Eval::analyzeQuote(ValueSpan nodes)
 {
 	CHECK_ARG_COUNT_IS("quote", nodes.size(), 1);
 
-	return nodes.front();
+	return std::make_shared<QuoteNode>(nodes.front());
 }
 
+// -----------------------------------------
+
+namespace {
+
+class TryNode final : public Executable {
+public:
+	TryNode(std::vector<ExecutablePtr>&& body, ScopePtr scope, ExecutablePtr handler)
+		: m_body(std::move(body))
+		, m_scope(std::move(scope))
+		, m_handler(std::move(handler))
+	{
+	}
+
+	virtual ValuePtr execute(const EnvironmentPtr& env) override
+	{
+		// Try
+
+		ValuePtr result;
+		for (const auto& executable : m_body) {
+			result = executable->execute(env);
+			if (Error::the().hasAnyError()) {
+				break;
+			}
+		}
+		if (!Error::the().hasAnyError()) {
+			return result;
+		}
+
+		// Catch
+
+		if (m_handler == nullptr) {
+			return nullptr;
+		}
+
+		// Get the error message
+		auto error = (Error::the().hasOtherError())
+		                 ? makePtr<String>(Error::the().otherError())
+		                 : Error::the().exception();
+		Error::the().clearErrors();
+
+		// Create new Environment that binds 'binding' to the value of the exception
+		auto catch_env = Environment::create(env, m_scope);
+		catch_env->setSlot(0, std::move(error));
+
+		// Evaluate 'handler' using the new Environment
+		return m_handler->execute(catch_env);
+	}
+
+private:
+	const std::vector<ExecutablePtr> m_body;
+	const ScopePtr m_scope; // Slot of the binding
+	const ExecutablePtr m_handler;
+};
+
+} // namespace
+
 EVAL_FUNCTION("try*", "body... [catch]", R"(Eval BODY allowing exceptions to get caught.
 
 CATCH should take the form of (catch* binding handler).
@@ -272,112 +477,194 @@ CATCH should take the form of (catch* binding handler).
 The BODY is evaluated, if it throws an exception, then form CATCH is
 handled by creating a new environment that binds the symbol BINDING
 to the value of the exception that was thrown. Finally, HANDLER is evaluated.)");
-ValuePtr Eval::evalTry(const ValueVector& nodes, EnvironmentPtr env)
+ExecutablePtr Eval::analyzeTry(ValueSpan nodes, const ScopePtr& scope)
 {
 	CHECK_ARG_COUNT_AT_LEAST("try*", nodes.size(), 1);
 
 	// Is last node a catch* block
 	bool is_last_node_catch = false;
 	std::span<const ValuePtr> catch_nodes;
-	if (nodes.size() >= 2 && is<List>(nodes.back().get())) {
+	if (nodes.size() >= 2 && is<List>(nodes.back())) {
 		VALUE_CAST(list, List, nodes.back());
 		catch_nodes = list->nodesRead();
-		if (!list->empty() && is<Symbol>(catch_nodes.front().get())) {
+		if (!list->empty() && is<Symbol>(catch_nodes.front())) {
 			VALUE_CAST(catch_symbol, Symbol, catch_nodes.front());
-			if (catch_symbol->symbol() == "catch*") {
+			if (catch_symbol->id() == Symbol::Catch) {
 				CHECK_ARG_COUNT_IS("catch*", catch_nodes.size() - 1, 2);
 				is_last_node_catch = true;
 			}
 		}
 	}
 
-	// Dont have to eval on malformed (catch*)
-	if (Error::the().hasAnyError()) {
+	auto end = (!is_last_node_catch) ? nodes.end() : std::prev(nodes.end(), 1);
+	auto body = analyzeSequence(nodes.begin(), end, scope);
+	if (body.empty()) {
 		return nullptr;
 	}
 
-	// Try
+	if (!is_last_node_catch) {
+		return std::make_shared<TryNode>(std::move(body), nullptr, nullptr);
+	}
 
-	ValuePtr result;
-	auto end = (!is_last_node_catch) ? nodes.end() : std::prev(nodes.end(), 1);
-	for (auto it = nodes.begin(); it != end; ++it) {
-		m_ast = *it;
-		m_env = env;
-		result = evalImpl();
+	VALUE_CAST(catch_binding, Symbol, (*std::next(catch_nodes.begin())));
+
+	auto catch_scope = Scope::create(scope, { catch_binding->id() });
+	auto handler = analyze(catch_nodes.back(), catch_scope, false);
+	if (handler == nullptr) {
+		return nullptr;
+	}
+
+	return std::make_shared<TryNode>(std::move(body), catch_scope, handler);
+}
+
+// -----------------------------------------
+
+namespace {
+
+class AndNode final : public Executable {
+public:
+	AndNode(std::vector<ExecutablePtr>&& nodes)
+		: m_nodes(std::move(nodes))
+	{
 	}
-	if (!Error::the().hasAnyError()) {
+
+	virtual ValuePtr execute(const EnvironmentPtr& env) override
+	{
+		ValuePtr result = makePtr<Constant>(Constant::True);
+		for (const auto& node : m_nodes) {
+			result = node->execute(env);
+			if (result == nullptr) {
+				return nullptr;
+			}
+
+			if (!isTruthy(result)) {
+				return makePtr<Constant>(Constant::Nil);
+			}
+		}
+
 		return result;
 	}
 
-	// Catch
+private:
+	const std::vector<ExecutablePtr> m_nodes;
+};
 
-	if (!is_last_node_catch) {
-		return nullptr;
+class DoNode final : public Executable {
+public:
+	DoNode(std::vector<ExecutablePtr>&& nodes, ExecutablePtr last)
+		: m_nodes(std::move(nodes))
+		, m_last(std::move(last))
+	{
 	}
 
-	// Get the error message
-	auto error = (Error::the().hasOtherError())
-	                 ? makePtr<String>(Error::the().otherError())
-	                 : Error::the().exception();
-	Error::the().clearErrors();
+	virtual ValuePtr execute(const EnvironmentPtr& env) override
+	{
+		// Evaluate all nodes except the last
+		for (const auto& node : m_nodes) {
+			node->execute(env);
+			if (Error::the().hasAnyError()) {
+				return nullptr;
+			}
+		}
 
-	VALUE_CAST(catch_binding, Symbol, (*std::next(catch_nodes.begin())));
+		// Eval last node
+		return m_last->execute(env);
+	}
 
-	// Create new Environment that binds 'binding' to the value of the exception
-	auto catch_env = Environment::create(env);
-	catch_env->set(catch_binding->symbol(), error);
+private:
+	const std::vector<ExecutablePtr> m_nodes;
+	const ExecutablePtr m_last;
+};
+
+class IfNode final : public Executable {
+public:
+	IfNode(ExecutablePtr condition, ExecutablePtr then, ExecutablePtr otherwise)
+		: m_condition(std::move(condition))
+		, m_then(std::move(then))
+		, m_otherwise(std::move(otherwise))
+	{
+	}
 
-	// Evaluate 'handler' using the new Environment
-	m_ast = catch_nodes.back();
-	m_env = catch_env;
-	return evalImpl();
-}
+	virtual ValuePtr execute(const EnvironmentPtr& env) override
+	{
+		auto condition = m_condition->execute(env);
+		if (condition == nullptr) {
+			return nullptr;
+		}
 
-// -----------------------------------------
+		return isTruthy(condition) ? m_then->execute(env) : m_otherwise->execute(env);
+	}
+
+private:
+	const ExecutablePtr m_condition;
+	const ExecutablePtr m_then;
+	const ExecutablePtr m_otherwise;
+};
+
+class LetNode final : public Executable {
+public:
+	LetNode(ScopePtr scope, std::vector<std::pair<uint32_t, ExecutablePtr>>&& bindings, ExecutablePtr body)
+		: m_scope(std::move(scope))
+		, m_bindings(std::move(bindings))
+		, m_body(std::move(body))
+	{
+	}
+
+	virtual ValuePtr execute(const EnvironmentPtr& env) override
+	{
+		// Create new environment
+		auto let_env = Environment::create(env, m_scope);
+
+		for (const auto& [slot, executable] : m_bindings) {
+			ValuePtr value = executable->execute(let_env);
+			if (value == nullptr) {
+				return nullptr;
+			}
+			let_env->setSlot(slot, std::move(value));
+		}
+
+		return m_body->execute(let_env);
+	}
+
+private:
+	const ScopePtr m_scope;
+	const std::vector<std::pair<uint32_t, ExecutablePtr>> m_bindings; // Slots
+	const ExecutablePtr m_body;
+};
+
+} // namespace
 
 EVAL_FUNCTION("and", "args...", R"(Eval ARGS until one of them yields nil, then return nil.
 
 The remaining args are not evalled at all.
 If no arg yields nil, return the last arg's value.)");
-void Eval::evalAnd(const ValueVector& nodes, EnvironmentPtr env)
+ExecutablePtr Eval::analyzeAnd(ValueSpan nodes, const ScopePtr& scope)
 {
-	ValuePtr result = makePtr<Constant>(Constant::True);
-	for (auto node : nodes) {
-		m_ast = node;
-		m_env = env;
-		result = evalImpl();
-
-		if (is<Constant>(result.get())) {
-			VALUE_CAST(constant, Constant, result, void());
-			if (constant->state() == Constant::Nil || constant->state() == Constant::False) {
-				m_ast = makePtr<Constant>(Constant::Nil);
-				m_env = env;
-				return; // TCO
-			}
-		}
+	auto executables = analyzeSequence(nodes.begin(), nodes.end(), scope);
+	if (executables.size() != nodes.size()) {
+		return nullptr;
 	}
 
-	m_ast = result;
-	m_env = env;
-	return; // TCO
+	return std::make_shared<AndNode>(std::move(executables));
 }
 
 EVAL_FUNCTION("do", "body...", "Eval BODY forms sequentially and return value of the last one.");
-void Eval::evalDo(const ValueVector& nodes, EnvironmentPtr env)
+ExecutablePtr Eval::analyzeDo(ValueSpan nodes, const ScopePtr& scope, bool tail)
 {
-	CHECK_ARG_COUNT_AT_LEAST("do", nodes.size(), 1, void());
+	CHECK_ARG_COUNT_AT_LEAST("do", nodes.size(), 1);
+
+	auto executables = analyzeSequence(nodes.begin(), std::prev(nodes.end()), scope);
+	if (executables.size() != nodes.size() - 1) {
+		return nullptr;
+	}
 
-	// Evaluate all nodes except the last
-	for (auto it = nodes.begin(); it != std::prev(nodes.end(), 1); ++it) {
-		m_ast = *it;
-		m_env = env;
-		evalImpl();
+	// Only the last node is in tail position
+	auto last = analyze(nodes.back(), scope, tail);
+	if (last == nullptr) {
+		return nullptr;
 	}
 
-	// Eval last node
-	m_ast = nodes.back();
-	m_env = env;
-	return; // TCO
+	return std::make_shared<DoNode>(std::move(executables), last);
 }
 
 EVAL_FUNCTION("if", "COND THEN [ELSE]", R"(If COND yields non-nil, do THEN, else do ELSE.
@@ -385,27 +672,22 @@ EVAL_FUNCTION("if", "COND THEN [ELSE]", R"(If COND yields non-nil, do THEN, else
 Returns the value of THEN or the value of ELSE.
 Both THEN and ELSE must be one expression.
 If COND yields nil, and there is no ELSE, the value is nil.)");
-void Eval::evalIf(const ValueVector& nodes, EnvironmentPtr env)
+ExecutablePtr Eval::analyzeIf(ValueSpan nodes, const ScopePtr& scope, bool tail)
 {
-	CHECK_ARG_COUNT_BETWEEN("if", nodes.size(), 2, 3, void());
+	CHECK_ARG_COUNT_BETWEEN("if", nodes.size(), 2, 3);
 
 	auto first_argument = *nodes.begin();
 	auto second_argument = *std::next(nodes.begin());
 	auto third_argument = (nodes.size() == 3) ? *std::next(std::next(nodes.begin())) : makePtr<Constant>(Constant::Nil);
 
-	m_ast = first_argument;
-	m_env = env;
-	auto first_evaluated = evalImpl();
-	if (!is<Constant>(first_evaluated.get())
-	    || std::static_pointer_cast<Constant>(first_evaluated)->state() == Constant::True) {
-		m_ast = second_argument;
-		m_env = env;
-		return; // TCO
+	auto condition = analyze(first_argument, scope, false);
+	auto then = analyze(second_argument, scope, tail);
+	auto otherwise = analyze(third_argument, scope, tail);
+	if (condition == nullptr || then == nullptr || otherwise == nullptr) {
+		return nullptr;
 	}
 
-	m_ast = third_argument;
-	m_env = env;
-	return; // TCO
+	return std::make_shared<IfNode>(condition, then, otherwise);
 }
 
 EVAL_FUNCTION("let*", "varlist body", R"(Bind variables accoring to VARLIST then eval BODY.
@@ -414,57 +696,68 @@ The value of the BODY form is returned.
 VARLIST is a list or vector with an even amount of elements,
 where each odd number is a symbol gets bind the even element.
 All even elements are evalled before any symbols are bound.)");
-void Eval::evalLet(const ValueVector& nodes, EnvironmentPtr env)
+ExecutablePtr Eval::analyzeLet(ValueSpan nodes, const ScopePtr& scope, bool tail)
 {
-	CHECK_ARG_COUNT_IS("let*", nodes.size(), 2, void());
+	CHECK_ARG_COUNT_IS("let*", nodes.size(), 2);
 
 	// First argument needs to be a List or Vector
-	VALUE_CAST(bindings, Collection, nodes.front(), void());
+	VALUE_CAST(bindings, Collection, nodes.front());
 	const auto& binding_nodes = bindings->nodesRead();
 
 	// List or Vector needs to have an even number of elements
-	CHECK_ARG_COUNT_EVEN("bindings", binding_nodes.size(), void());
-
-	// Create new environment
-	auto let_env = Environment::create(env);
+	CHECK_ARG_COUNT_EVEN("bindings", binding_nodes.size());
 
+	// All symbols get their slot up front, so that a fn* in the bindings can
+	// refer to a binding that comes after it
+	auto let_scope = Scope::create(scope);
 	for (auto it = binding_nodes.begin(); it != binding_nodes.end(); std::advance(it, 2)) {
 		// First element needs to be a Symbol
-		VALUE_CAST(elt, Symbol, (*it), void());
+		VALUE_CAST(elt, Symbol, (*it));
+		let_scope->add(elt->id());
+	}
 
-		std::string key = elt->symbol();
-		m_ast = *std::next(it);
-		m_env = let_env;
-		ValuePtr value = evalImpl();
-		let_env->set(key, value);
+	std::vector<std::pair<uint32_t, ExecutablePtr>> analyzed_bindings;
+	analyzed_bindings.reserve(binding_nodes.size() / 2);
+	for (auto it = binding_nodes.begin(); it != binding_nodes.end(); std::advance(it, 2)) {
+		auto value = analyze(*std::next(it), let_scope, false);
+		if (value == nullptr) {
+			return nullptr;
+		}
+		analyzed_bindings.emplace_back(let_scope->find(valueCast<Symbol>(*it)->id()), value);
 	}
 
 	// TODO: Remove limitation of 3 arguments
 	// Eval all arguments in this new env, return last sexp of the result
-	m_ast = *std::next(nodes.begin());
-	m_env = let_env;
-	return; // TCO
+	auto body = analyze(*std::next(nodes.begin()), let_scope, tail);
+	if (body == nullptr) {
+		return nullptr;
+	}
+
+	return std::make_shared<LetNode>(let_scope, std::move(analyzed_bindings), body);
 }
 
 // -----------------------------------------
 
 // (x y z)
-static bool isMacroCall(ValuePtr ast, EnvironmentPtr env)
+static bool isMacroCall(const ValuePtr& ast, const EnvironmentPtr& env)
 {
-	auto list = dynamic_cast<List*>(ast.get());
+	if (!is<List>(ast)) {
+		return false;
+	}
+
+	auto list = valueCast<List>(ast);
 
-	if (list == nullptr || list->empty()) {
+	if (list->empty()) {
 		return false;
 	}
 
-	auto front = list->front().get();
+	const auto& front = list->front();
 
 	if (!is<Symbol>(front)) {
 		return false;
 	}
 
-	auto symbol = dynamic_cast<Symbol*>(front)->symbol();
-	auto value = env->get(symbol).get();
+	auto value = env->get(valueCast<Symbol>(front)->id());
 
 	if (!is<Macro>(value)) {
 		return false;
@@ -473,25 +766,70 @@ static bool isMacroCall(ValuePtr ast, EnvironmentPtr env)
 	return true;
 }
 
-EVAL_FUNCTION("macroexpand-1", "expression", "Macroexpand EXPRESSION and pretty-print its value.");
-void Eval::evalMacroExpand1(const ValueVector& nodes, EnvironmentPtr env)
-{
-	CHECK_ARG_COUNT_IS("macroexpand-1", nodes.size(), 1, void());
+namespace {
 
-	if (!isMacroCall(nodes.front(), env)) {
-		m_ast = nodes.front();
-		m_env = env;
-		return;
+class MacroExpand1Node final : public Executable {
+public:
+	MacroExpand1Node(ValuePtr expression)
+		: m_expression(std::move(expression))
+	{
 	}
 
-	auto list = std::static_pointer_cast<List>(nodes.front());
+	virtual ValuePtr execute(const EnvironmentPtr& env) override
+	{
+		if (!isMacroCall(m_expression, env)) {
+			if (m_executable == nullptr) {
+				m_executable = Eval::analyze(m_expression, env->scope(), false);
+			}
+			return (m_executable) ? m_executable->execute(env) : nullptr;
+		}
 
-	auto value = env->get(std::static_pointer_cast<Symbol>(list->front())->symbol());
-	auto lambda = std::static_pointer_cast<Lambda>(value);
+		auto list = valueCast<List>(m_expression);
+
+		auto value = env->get(valueCast<Symbol>(list->front())->id());
+		return Eval::expand(value, ValueVector(std::next(list->begin()), list->end()));
+	}
 
-	m_ast = lambda->body();
-	m_env = Environment::create(lambda, list->rest());
-	return; // TCO
+private:
+	const ValuePtr m_expression;
+	ExecutablePtr m_executable;
+};
+
+class OrNode final : public Executable {
+public:
+	OrNode(std::vector<ExecutablePtr>&& nodes)
+		: m_nodes(std::move(nodes))
+	{
+	}
+
+	virtual ValuePtr execute(const EnvironmentPtr& env) override
+	{
+		for (const auto& node : m_nodes) {
+			auto result = node->execute(env);
+			if (result == nullptr) {
+				return nullptr;
+			}
+
+			if (isTruthy(result)) {
+				return result;
+			}
+		}
+
+		return makePtr<Constant>(Constant::Nil);
+	}
+
+private:
+	const std::vector<ExecutablePtr> m_nodes;
+};
+
+} // namespace
+
+EVAL_FUNCTION("macroexpand-1", "expression", "Macroexpand EXPRESSION and pretty-print its value.");
+ExecutablePtr Eval::analyzeMacroExpand1(ValueSpan nodes)
+{
+	CHECK_ARG_COUNT_IS("macroexpand-1", nodes.size(), 1);
+
+	return std::make_shared<MacroExpand1Node>(nodes.front());
 }
 
 // -----------------------------------------
@@ -500,132 +838,253 @@ EVAL_FUNCTION("or", "args...", R"(Eval ARGS until one of them yields non-nil, th
 
 The remaining args are not evalled at all.
 If all args return nil, return nil.)");
-void Eval::evalOr(const ValueVector& nodes, EnvironmentPtr env)
+ExecutablePtr Eval::analyzeOr(ValueSpan nodes, const ScopePtr& scope)
 {
-	ValuePtr result;
-	for (auto node : nodes) {
-		m_ast = node;
-		m_env = env;
-		result = evalImpl();
-
-		if (!is<Constant>(result.get())) {
-			m_ast = result;
-			m_env = env;
-			return; // TCO
-		}
-
-		VALUE_CAST(constant, Constant, result, void());
-		if (constant->state() == Constant::True) {
-			m_ast = result;
-			m_env = env;
-			return; // TCO
-		}
+	auto executables = analyzeSequence(nodes.begin(), nodes.end(), scope);
+	if (executables.size() != nodes.size()) {
+		return nullptr;
 	}
 
-	m_ast = makePtr<Constant>(Constant::Nil);
-	m_env = env;
-	return; // TCO
+	return std::make_shared<OrNode>(std::move(executables));
 }
 
 // -----------------------------------------
 
-static bool isSymbol(ValuePtr value, const std::string& symbol)
+static bool isSymbol(const ValuePtr& value, uint32_t symbol)
 {
-	if (!is<Symbol>(value.get())) {
+	if (!is<Symbol>(value)) {
 		return false;
 	}
 
-	auto value_symbol = std::static_pointer_cast<Symbol>(value)->symbol();
-
-	if (value_symbol != symbol) {
+	if (valueCast<Symbol>(value)->id() != symbol) {
 		return false;
 	}
 
 	return true;
 }
 
-static ValuePtr startsWith(ValuePtr ast, const std::string& symbol)
+ValuePtr Eval::startsWith(const ValuePtr& ast, uint32_t symbol)
 {
-	if (!is<List>(ast.get())) {
+	if (!is<List>(ast)) {
 		return nullptr;
 	}
 
-	const auto& nodes = std::static_pointer_cast<List>(ast)->nodesRead();
+	const auto& nodes = valueCast<List>(ast)->nodesRead();
 
 	if (nodes.empty() || !isSymbol(nodes.front(), symbol)) {
 		return nullptr;
 	}
 
 	// Dont count the Symbol as part of the arguments
-	CHECK_ARG_COUNT_IS(symbol, nodes.size() - 1, 1);
+	CHECK_ARG_COUNT_IS(Symbol::find(symbol)->symbol(), nodes.size() - 1, 1);
 
 	return *std::next(nodes.begin());
 }
 
-static ValuePtr evalQuasiQuoteImpl(ValuePtr ast)
+ValuePtr Eval::quasiQuote(const ValuePtr& ast)
 {
-	if (is<HashMap>(ast.get()) || is<Symbol>(ast.get())) {
-		return makePtr<List>(makePtr<Symbol>("quote"), ast);
+	if (is<HashMap>(ast) || is<Symbol>(ast)) {
+		return makePtr<List>(Symbol::create(Symbol::Quote), ast);
 	}
 
-	if (!is<Collection>(ast.get())) {
+	if (!is<Collection>(ast)) {
 		return ast;
 	}
 
 	// `~2 or `(unquote 2)
-	const auto unquote = startsWith(ast, "unquote"); // x
+	const auto unquote = startsWith(ast, Symbol::Unquote); // x
 	if (unquote) {
 		return unquote;
 	}
 
 	// `~@(list 2 2 2) or `(splice-unquote (list 2 2 2))
-	const auto splice_unquote = startsWith(ast, "splice-unquote"); // (list 2 2 2)
+	const auto splice_unquote = startsWith(ast, Symbol::SpliceUnquote); // (list 2 2 2)
 	if (splice_unquote) {
 		return splice_unquote;
 	}
 
 	ValuePtr result = makePtr<List>();
 
-	auto collection = std::static_pointer_cast<Collection>(ast);
+	auto collection = valueCast<Collection>(ast);
 
 	// `() or `(1 ~2 3) or `(1 ~@(list 2 2 2) 3)
 	for (auto it = collection->beginReverse(); it != collection->endReverse(); ++it) {
 		const auto& elt = *it;
 
-		const auto splice_unquote = startsWith(elt, "splice-unquote"); // (list 2 2 2)
+		const auto splice_unquote = startsWith(elt, Symbol::SpliceUnquote); // (list 2 2 2)
 		if (splice_unquote) {
 			// (cons 1 (concat (list 2 2 2) (cons 3 ())))
-			result = makePtr<List>(makePtr<Symbol>("concat"), splice_unquote, result);
+			result = makePtr<List>(Symbol::create(Symbol::Concat), splice_unquote, result);
 			continue;
 		}
 
 		// (cons 1 (cons 2 (cons 3 ())))
-		result = makePtr<List>(makePtr<Symbol>("cons"), evalQuasiQuoteImpl(elt), result);
+		result = makePtr<List>(Symbol::create(Symbol::Cons), quasiQuote(elt), result);
 	}
 
-	if (is<List>(ast.get())) {
+	if (is<List>(ast)) {
 		return result;
 	}
 
 	// Wrap result in (vec) for Vector types
-	return makePtr<List>(makePtr<Symbol>("vec"), result);
+	return makePtr<List>(Symbol::create(Symbol::Vec), result);
+}
+
+bool Eval::isQuasiQuoteConstant(const ValuePtr& ast)
+{
+	// Symbols and hash-maps are quoted, anything else evaluates to itself
+	if (!is<List>(ast) && !is<Vector>(ast)) {
+		return true;
+	}
+
+	auto collection = valueCast<Collection>(ast);
+	if (!collection->empty()) {
+		const auto& front = collection->front();
+		if (is<List>(ast) && (isSymbol(front, Symbol::Unquote) || isSymbol(front, Symbol::SpliceUnquote))) {
+			return false;
+		}
+	}
+
+	for (const auto& node : collection->nodesRead()) {
+		if ((is<List>(node) || is<Vector>(node)) && !isQuasiQuoteConstant(node)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+namespace {
+
+// `(1 ~x ~@xs), the elements are built straight into the result instead of
+// calling cons and concat
+class QuasiQuoteNode final : public Executable {
+public:
+	QuasiQuoteNode(std::vector<std::pair<ExecutablePtr, bool>>&& elements, bool vector)
+		: m_elements(std::move(elements))
+		, m_vector(vector)
+	{
+	}
+
+	virtual ValuePtr execute(const EnvironmentPtr& env) override
+	{
+		ValueVector nodes;
+		nodes.reserve(m_elements.size());
+		for (const auto& [element, splice] : m_elements) {
+			auto value = element->execute(env);
+			if (value == nullptr) {
+				return nullptr;
+			}
+			if (!splice) {
+				nodes.push_back(std::move(value));
+				continue;
+			}
+
+			VALUE_CAST(collection, Collection, value);
+			const auto& spliced = collection->nodesRead();
+			nodes.insert(nodes.end(), spliced.begin(), spliced.end());
+		}
+
+		if (m_vector) {
+			return makePtr<Vector>(std::move(nodes));
+		}
+		return makePtr<List>(std::move(nodes));
+	}
+
+private:
+	const std::vector<std::pair<ExecutablePtr, bool>> m_elements; // Splice when true
+	const bool m_vector { false };
+};
+
+} // namespace
+
+static ExecutablePtr analyzeTemplate(const ValuePtr& ast, const ScopePtr& scope, bool tail)
+{
+	// Parts without unquotes are not rebuilt, just like quote
+	if (Eval::isQuasiQuoteConstant(ast)) {
+		return std::make_shared<QuoteNode>(ast);
+	}
+
+	// `~x or `~@x
+	auto unquote = Eval::startsWith(ast, Symbol::Unquote);
+	if (unquote == nullptr) {
+		unquote = Eval::startsWith(ast, Symbol::SpliceUnquote);
+	}
+	if (unquote) {
+		return Eval::analyze(unquote, scope, tail);
+	}
+	if (Error::the().hasAnyError()) {
+		return nullptr;
+	}
+
+	const auto& nodes = valueCast<Collection>(ast)->nodesRead();
+	std::vector<std::pair<ExecutablePtr, bool>> elements;
+	elements.reserve(nodes.size());
+	for (const auto& node : nodes) {
+		auto splice_unquote = Eval::startsWith(node, Symbol::SpliceUnquote);
+		if (Error::the().hasAnyError()) {
+			return nullptr;
+		}
+		auto element = (splice_unquote) ? Eval::analyze(splice_unquote, scope, false)
+		                                : analyzeTemplate(node, scope, false);
+		if (element == nullptr) {
+			return nullptr;
+		}
+		elements.emplace_back(element, splice_unquote != nullptr);
+	}
+
+	return std::make_shared<QuasiQuoteNode>(std::move(elements), is<Vector>(ast));
 }
 
 // (quasiquote x)
 EVAL_FUNCTION("quasiquote", "arg", R"()"); // TODO
-void Eval::evalQuasiQuote(const ValueVector& nodes, EnvironmentPtr env)
+ExecutablePtr Eval::analyzeQuasiQuote(ValueSpan nodes, const ScopePtr& scope, bool tail)
 {
-	CHECK_ARG_COUNT_IS("quasiquote", nodes.size(), 1, void());
+	CHECK_ARG_COUNT_IS("quasiquote", nodes.size(), 1);
 
-	auto result = evalQuasiQuoteImpl(nodes.front());
-
-	m_ast = result;
-	m_env = env;
-	return; // TCO
+	return analyzeTemplate(nodes.front(), scope, tail);
 }
 
 // -----------------------------------------
 
+namespace {
+
+class WhileNode final : public Executable {
+public:
+	WhileNode(ExecutablePtr condition, std::vector<ExecutablePtr>&& body)
+		: m_condition(std::move(condition))
+		, m_body(std::move(body))
+	{
+	}
+
+	virtual ValuePtr execute(const EnvironmentPtr& env) override
+	{
+		ValuePtr condition = m_condition->execute(env);
+		while (condition != nullptr && isTruthy(condition)) {
+			for (const auto& executable : m_body) {
+				executable->execute(env);
+				if (Error::the().hasAnyError()) {
+					return nullptr;
+				}
+			}
+
+			condition = m_condition->execute(env);
+		}
+
+		if (condition == nullptr) {
+			return nullptr;
+		}
+
+		return makePtr<Constant>();
+	}
+
+private:
+	const ExecutablePtr m_condition;
+	const std::vector<ExecutablePtr> m_body;
+};
+
+} // namespace
+
 // (while true body...)
 EVAL_FUNCTION("while", "test body...", R"(If TEST yields non-nil, eval BODY... and repeat
 
@@ -633,32 +1092,22 @@ The order of execution is thus TEST, BODY, TEST, BODY and so on
 until TEST returns nil.
 
 The value of a while form is always nil.)");
-void Eval::evalWhile(const ValueVector& nodes, EnvironmentPtr env)
+ExecutablePtr Eval::analyzeWhile(ValueSpan nodes, const ScopePtr& scope)
 {
-	CHECK_ARG_COUNT_AT_LEAST("while", nodes.size(), 2, void());
+	CHECK_ARG_COUNT_AT_LEAST("while", nodes.size(), 2);
 
 	// Condition
-	ValuePtr predicate = *nodes.begin();
-
-	m_ast = predicate;
-	m_env = env;
-	ValuePtr condition = evalImpl();
-	while (!is<Constant>(condition.get())
-	       || std::static_pointer_cast<Constant>(condition)->state() == Constant::True) {
-		for (auto it = nodes.begin() + 1; it != nodes.end(); ++it) {
-			m_ast = *it;
-			m_env = env;
-			evalImpl();
-		}
+	auto condition = analyze(nodes.front(), scope, false);
+	if (condition == nullptr) {
+		return nullptr;
+	}
 
-		m_ast = predicate;
-		m_env = env;
-		condition = evalImpl();
+	auto body = analyzeSequence(std::next(nodes.begin()), nodes.end(), scope);
+	if (body.size() != nodes.size() - 1) {
+		return nullptr;
 	}
 
-	m_ast = makePtr<Constant>();
-	m_env = env;
-	return; // TCO
+	return std::make_shared<WhileNode>(condition, std::move(body));
 }
 
 // -----------------------------------------
@@ -4,11 +4,11 @@
  * SPDX-License-Identifier: MIT
  */
 
-#include <iterator> // std::advance, std::next, std::prev
-#include <list>
-#include <memory> // std::static_pointer_cast
-#include <span>   // std::span
-#include <string>
+#include <cstddef> // size_t
+#include <cstdint> // int64_t, uint32_t
+#include <memory>  // std::make_shared
+#include <utility> // std::move, std::pair
+#include <vector>
 
 #include "blaze/ast.h"
 #include "blaze/env/environment.h"
@@ -21,11 +21,13 @@
 namespace blaze {
 
 std::vector<SpecialFormParts> Eval::s_special_form_parts;
+size_t Eval::s_expansions_saved = 0;
+ValuePtr Eval::s_tail_lambda;
+EnvironmentPtr Eval::s_tail_env;
 
 Eval::Eval(ValuePtr ast, EnvironmentPtr env)
-	: m_ast(ast)
-	, m_env(env)
-	, m_outer_env(env)
+	: m_ast(std::move(ast))
+	, m_env(std::move(env))
 {
 }
 
@@ -38,199 +40,588 @@ void Eval::registerSpecialForm(SpecialFormParts special_form_parts)
 
 void Eval::eval()
 {
-	m_ast = evalImpl();
+	if (Error::the().hasAnyError()) {
+		m_ast = nullptr;
+		return;
+	}
+
+	auto executable = analyze(m_ast, m_env->scope(), false);
+	m_ast = (executable) ? executable->execute(m_env) : nullptr;
 }
 
-ValuePtr Eval::evalImpl()
-{
-	ValuePtr ast = nullptr;
-	EnvironmentPtr env = nullptr;
+// -----------------------------------------
+
+namespace {
 
-	if (env == nullptr) {
-		env = m_outer_env;
+// Values that evaluate to themselves
+class ValueNode final : public Executable {
+public:
+	ValueNode(ValuePtr value)
+		: m_value(std::move(value))
+	{
 	}
 
-	while (true) {
-		if (Error::the().hasAnyError()) {
+	virtual ValuePtr execute(const EnvironmentPtr&) override { return m_value; }
+
+private:
+	const ValuePtr m_value;
+};
+
+class SymbolNode final : public Executable {
+public:
+	SymbolNode(ValuePtr symbol, Scope::Address address)
+		: m_symbol(std::move(symbol))
+		, m_id(valueCast<Symbol>(m_symbol)->id())
+		, m_address(address)
+	{
+	}
+
+	virtual ValuePtr execute(const EnvironmentPtr& env) override
+	{
+		auto result = env->get(m_address, m_id);
+		if (!result) {
+			Error::the().add(::format("'{}' not found", m_symbol));
 			return nullptr;
 		}
 
-		ast = m_ast;
-		env = m_env;
+		return result;
+	}
 
-		if (is<Symbol>(ast.get())) {
-			return evalSymbol(ast, env);
-		}
-		if (is<Vector>(ast.get())) {
-			return evalVector(ast, env);
+private:
+	const ValuePtr m_symbol;
+	const uint32_t m_id { 0 };
+	const Scope::Address m_address;
+};
+
+class VectorNode final : public Executable {
+public:
+	VectorNode(std::vector<ExecutablePtr>&& nodes)
+		: m_nodes(std::move(nodes))
+	{
+	}
+
+	virtual ValuePtr execute(const EnvironmentPtr& env) override
+	{
+		size_t count = m_nodes.size();
+		auto evaluated_nodes = ValueVector(count);
+		for (size_t i = 0; i < count; ++i) {
+			evaluated_nodes[i] = m_nodes[i]->execute(env);
+			if (evaluated_nodes[i] == nullptr) {
+				return nullptr;
+			}
 		}
-		if (is<HashMap>(ast.get())) {
-			return evalHashMap(ast, env);
+
+		return makePtr<Vector>(std::move(evaluated_nodes));
+	}
+
+private:
+	const std::vector<ExecutablePtr> m_nodes;
+};
+
+class HashMapNode final : public Executable {
+public:
+	HashMapNode(std::vector<std::pair<ExecutablePtr, ExecutablePtr>>&& elements)
+		: m_elements(std::move(elements))
+	{
+	}
+
+	virtual ValuePtr execute(const EnvironmentPtr& env) override
+	{
+		Elements evaluated_elements;
+		for (const auto& [key, value] : m_elements) {
+			ValuePtr key_node = key->execute(env);
+			if (key_node == nullptr) {
+				return nullptr;
+			}
+			ValuePtr element_node = value->execute(env);
+			if (element_node == nullptr) {
+				return nullptr;
+			}
+			evaluated_elements.insert_or_assign(std::move(key_node), std::move(element_node));
 		}
-		if (!is<List>(ast.get())) {
-			return ast;
+
+		return makePtr<HashMap>(evaluated_elements);
+	}
+
+private:
+	const std::vector<std::pair<ExecutablePtr, ExecutablePtr>> m_elements;
+};
+
+// (function arguments...)
+class CallNode final : public Executable {
+public:
+	CallNode(ValuePtr list, ExecutablePtr function, bool tail)
+		: m_list(std::move(list))
+		, m_function(std::move(function))
+		, m_tail(tail)
+	{
+	}
+
+	virtual ValuePtr execute(const EnvironmentPtr& env) override
+	{
+		auto function = m_function->execute(env);
+		if (function == nullptr) {
+			return nullptr;
 		}
 
-		auto list = std::static_pointer_cast<List>(ast);
+		// Macros are only known at runtime, so the arguments could still be
+		// unevaluated syntax
+		if (is<Macro>(function)) {
+			return expandMacro(function, env);
+		}
 
-		if (list->empty()) {
-			return ast;
+		if (!analyzeArguments(env->scope())) {
+			return nullptr;
 		}
 
-		// Special forms
-		if (is<Symbol>(list->front().get())) {
-			auto symbol = std::static_pointer_cast<Symbol>(list->front())->symbol();
-			const auto& nodes = list->rest();
-			if (symbol == "def!") {
-				return evalDef(nodes, env);
-			}
-			if (symbol == "defmacro!") {
-				return evalDefMacro(nodes, env);
-			}
-			if (symbol == "describe") {
-				return evalDescribe(nodes, env);
-			}
-			if (symbol == "fn*") {
-				return evalFn(nodes, env);
-			}
-			if (symbol == "quasiquoteexpand") {
-				return evalQuasiQuoteExpand(nodes);
-			}
-			if (symbol == "quote") {
-				return evalQuote(nodes);
-			}
-			if (symbol == "try*") {
-				return evalTry(nodes, env);
-			}
-			// Tail call optimized functions
-			if (symbol == "and") {
-				evalAnd(nodes, env);
-				continue; // TCO
+		size_t count = m_arguments.size();
+
+		// The arguments of a Lambda are evaluated straight into the vector its
+		// Environment keeps
+		if (is<Lambda>(function)) {
+			auto arguments = ValueVector(count);
+			if (!evaluateArguments(env, arguments.data())) {
+				return nullptr;
 			}
-			if (symbol == "do") {
-				evalDo(nodes, env);
-				continue; // TCO
+
+			auto lambda_env = Environment::create(function, std::move(arguments));
+			if (lambda_env == nullptr) {
+				return nullptr;
 			}
-			if (symbol == "if") {
-				evalIf(nodes, env);
-				continue; // TCO
+
+			if (m_tail) {
+				Eval::tailCall(std::move(function), std::move(lambda_env));
+				return nullptr;
 			}
-			if (symbol == "let*") {
-				evalLet(nodes, env);
-				continue; // TCO
+
+			return Eval::run(std::move(function), std::move(lambda_env));
+		}
+
+		// Builtins only look at their arguments, so they go in a buffer on the
+		// stack unless there are too many
+		ValuePtr buffer[s_buffer_size];
+		ValueVector overflow;
+		ValuePtr* arguments = buffer;
+		if (count > s_buffer_size) {
+			overflow.resize(count);
+			arguments = overflow.data();
+		}
+		if (!evaluateArguments(env, arguments)) {
+			return nullptr;
+		}
+
+		if (!is<Function>(function)) {
+			Error::the().add(::format("invalid function: {}", function));
+			return nullptr;
+		}
+
+		return valueCast<Function>(function)->call(ValueSpan(arguments, count));
+	}
+
+private:
+	static constexpr size_t s_buffer_size = 8;
+
+	bool evaluateArguments(const EnvironmentPtr& env, ValuePtr* arguments)
+	{
+		size_t count = m_arguments.size();
+		for (size_t i = 0; i < count; ++i) {
+			arguments[i] = m_arguments[i]->execute(env);
+			if (arguments[i] == nullptr) {
+				return false;
 			}
-			if (symbol == "macroexpand-1") {
-				evalMacroExpand1(nodes, env);
-				continue; // TCO
+		}
+
+		return true;
+	}
+
+	// The expansion only depends on the Macro and the syntax of the call, so
+	// it is kept until the symbol is bound to a different Macro
+	ValuePtr expandMacro(const ValuePtr& macro, const EnvironmentPtr& env)
+	{
+		if (macro != m_macro) {
+			auto list = valueCast<List>(m_list);
+			auto expanded = Eval::expand(macro, ValueVector(std::next(list->begin()), list->end()));
+			if (expanded == nullptr) {
+				return nullptr;
 			}
-			if (symbol == "or") {
-				evalOr(nodes, env);
-				continue; // TCO
+			auto expansion = Eval::analyze(expanded, env->scope(), m_tail);
+			if (expansion == nullptr) {
+				return nullptr;
 			}
-			if (symbol == "quasiquote") {
-				evalQuasiQuote(nodes, env);
-				continue; // TCO
+			m_macro = macro;
+			m_expansion = std::move(expansion);
+		}
+		else {
+			Eval::countSavedExpansion();
+		}
+
+		// Keep it alive, running it could replace the cached one
+		auto expansion = m_expansion;
+		return expansion->execute(env);
+	}
+
+	bool analyzeArguments(const ScopePtr& scope)
+	{
+		if (m_analyzed) {
+			return true;
+		}
+
+		const auto& nodes = valueCast<List>(m_list)->nodesRead();
+		std::vector<ExecutablePtr> arguments;
+		arguments.reserve(nodes.size() - 1);
+		for (auto it = nodes.begin() + 1; it != nodes.end(); ++it) {
+			auto argument = Eval::analyze(*it, scope, false);
+			if (argument == nullptr) {
+				return false;
 			}
-			if (symbol == "while") {
-				evalWhile(nodes, env);
-				continue; // TCO
+			arguments.push_back(std::move(argument));
+		}
+
+		m_arguments = std::move(arguments);
+		m_analyzed = true;
+
+		return true;
+	}
+
+	const ValuePtr m_list;
+	const ExecutablePtr m_function;
+	const bool m_tail { false };
+
+	// Analyzed on first use, the arguments of a macro call are never evaluated
+	bool m_analyzed { false };
+	std::vector<ExecutablePtr> m_arguments;
+
+	// Expansion of the last Macro called here
+	ValuePtr m_macro;
+	ExecutablePtr m_expansion;
+};
+
+// (+ a b), see Eval::intrinsic()
+class IntrinsicNode final : public Executable {
+public:
+	IntrinsicNode(ValuePtr list, uint32_t symbol, bool tail)
+		: m_list(std::move(list))
+		, m_symbol(symbol)
+		, m_tail(tail)
+	{
+	}
+
+	virtual ValuePtr execute(const EnvironmentPtr& env) override
+	{
+		// Analyzed again as a regular call, now that the Symbol is rebound
+		if (Environment::isRebound(m_symbol)) {
+			if (m_call == nullptr) {
+				m_call = Eval::analyze(m_list, env->scope(), m_tail);
+				if (m_call == nullptr) {
+					return nullptr;
+				}
 			}
+			return m_call->execute(env);
 		}
 
-		m_ast = list->front();
-		m_env = env;
-		auto evaluated_front = evalImpl();
-		auto unevaluated_nodes = list->rest();
+		if (!analyzeArguments(env->scope())) {
+			return nullptr;
+		}
 
-		if (is<Macro>(evaluated_front.get())) { // FIXME
-			auto lambda = std::static_pointer_cast<Lambda>(evaluated_front);
-			m_ast = lambda->body();
-			m_env = Environment::create(lambda, std::move(unevaluated_nodes));
-			m_ast = evalImpl();
-			m_env = env;
-			continue; // TCO
+		ValuePtr arguments[2];
+		size_t count = m_arguments.size();
+		for (size_t i = 0; i < count; ++i) {
+			arguments[i] = m_arguments[i]->execute(env);
+			if (arguments[i] == nullptr) {
+				return nullptr;
+			}
 		}
 
-		ValueVector evaluated_nodes(unevaluated_nodes.size());
-		for (size_t i = 0; i < unevaluated_nodes.size(); ++i) {
-			m_ast = unevaluated_nodes[i];
-			m_env = env;
-			evaluated_nodes[i] = evalImpl();
+		auto result = Eval::intrinsic(m_symbol, arguments);
+		if (result) {
+			return result;
 		}
 
-		// Regular list
-		if (is<Lambda>(evaluated_front.get())) {
-			auto lambda = std::static_pointer_cast<Lambda>(evaluated_front);
+		return valueCast<Function>(Environment::builtin(m_symbol))->call(ValueSpan(arguments, count));
+	}
 
-			m_ast = lambda->body();
-			m_env = Environment::create(lambda, std::move(evaluated_nodes));
-			continue; // TCO
+private:
+	bool analyzeArguments(const ScopePtr& scope)
+	{
+		if (!m_arguments.empty()) {
+			return true;
 		}
 
-		// Function call
-		return apply(evaluated_front, evaluated_nodes);
+		const auto& nodes = valueCast<List>(m_list)->nodesRead();
+		std::vector<ExecutablePtr> arguments;
+		for (auto it = nodes.begin() + 1; it != nodes.end(); ++it) {
+			auto argument = Eval::analyze(*it, scope, false);
+			if (argument == nullptr) {
+				return false;
+			}
+			arguments.push_back(std::move(argument));
+		}
+
+		m_arguments = std::move(arguments);
+
+		return true;
 	}
-}
 
-ValuePtr Eval::evalSymbol(ValuePtr ast, EnvironmentPtr env)
+	const ValuePtr m_list;
+	const uint32_t m_symbol { 0 };
+	const bool m_tail { false };
+
+	// Analyzed on first use, like the arguments of a CallNode
+	std::vector<ExecutablePtr> m_arguments;
+	ExecutablePtr m_call;
+};
+
+} // namespace
+
+ExecutablePtr Eval::analyze(const ValuePtr& ast, const ScopePtr& scope, bool tail)
 {
-	auto result = env->get(std::static_pointer_cast<Symbol>(ast)->symbol());
-	if (!result) {
-		Error::the().add(::format("'{}' not found", ast));
-		return nullptr;
+	if (is<Symbol>(ast)) {
+		return analyzeSymbol(ast, scope);
+	}
+	if (is<Vector>(ast)) {
+		return analyzeVector(ast, scope);
+	}
+	if (is<HashMap>(ast)) {
+		return analyzeHashMap(ast, scope);
+	}
+	if (!is<List>(ast) || valueCast<List>(ast)->empty()) {
+		return std::make_shared<ValueNode>(ast);
 	}
 
-	return result;
+	auto list = valueCast<List>(ast);
+
+	// Special forms
+	if (is<Symbol>(list->front()) && valueCast<Symbol>(list->front())->isSpecialForm()) {
+		auto nodes = list->nodesRead().subspan(1);
+		switch (valueCast<Symbol>(list->front())->id()) {
+		case Symbol::Def:
+			return analyzeDef(nodes, scope);
+		case Symbol::DefMacro:
+			return analyzeDefMacro(nodes, scope);
+		case Symbol::Describe:
+			return analyzeDescribe(nodes);
+		case Symbol::Fn:
+			return analyzeFn(nodes, scope);
+		case Symbol::QuasiQuoteExpand:
+			return analyzeQuasiQuoteExpand(nodes);
+		case Symbol::Quote:
+			return analyzeQuote(nodes);
+		case Symbol::Try:
+			return analyzeTry(nodes, scope);
+		case Symbol::And:
+			return analyzeAnd(nodes, scope);
+		case Symbol::Do:
+			return analyzeDo(nodes, scope, tail);
+		case Symbol::If:
+			return analyzeIf(nodes, scope, tail);
+		case Symbol::Let:
+			return analyzeLet(nodes, scope, tail);
+		case Symbol::MacroExpand1:
+			return analyzeMacroExpand1(nodes);
+		case Symbol::Or:
+			return analyzeOr(nodes, scope);
+		case Symbol::QuasiQuote:
+			return analyzeQuasiQuote(nodes, scope, tail);
+		case Symbol::While:
+			return analyzeWhile(nodes, scope);
+		default:
+			break;
+		}
+	}
+
+	return analyzeCall(ast, scope, tail);
 }
 
-ValuePtr Eval::evalVector(ValuePtr ast, EnvironmentPtr env)
+ExecutablePtr Eval::analyzeSymbol(const ValuePtr& ast, const ScopePtr& scope)
 {
-	const auto& nodes = std::static_pointer_cast<Collection>(ast)->nodesRead();
-	size_t count = nodes.size();
-	auto evaluated_nodes = ValueVector(count);
+	auto address = Scope::resolve(scope.get(), valueCast<Symbol>(ast)->id());
+	return std::make_shared<SymbolNode>(ast, address);
+}
 
-	for (size_t i = 0; i < count; ++i) {
-		m_ast = nodes[i];
-		m_env = env;
-		ValuePtr eval_node = evalImpl();
-		if (eval_node == nullptr) {
+ExecutablePtr Eval::analyzeVector(const ValuePtr& ast, const ScopePtr& scope)
+{
+	const auto& nodes = valueCast<Collection>(ast)->nodesRead();
+	std::vector<ExecutablePtr> analyzed_nodes;
+	analyzed_nodes.reserve(nodes.size());
+	for (const auto& node : nodes) {
+		auto analyzed_node = analyze(node, scope, false);
+		if (analyzed_node == nullptr) {
 			return nullptr;
 		}
-		evaluated_nodes.at(i) = eval_node;
+		analyzed_nodes.push_back(std::move(analyzed_node));
 	}
 
-	return makePtr<Vector>(evaluated_nodes);
+	return std::make_shared<VectorNode>(std::move(analyzed_nodes));
 }
 
-ValuePtr Eval::evalHashMap(ValuePtr ast, EnvironmentPtr env)
+ExecutablePtr Eval::analyzeHashMap(const ValuePtr& ast, const ScopePtr& scope)
 {
-	const auto& elements = std::static_pointer_cast<HashMap>(ast)->elements();
-	Elements evaluated_elements;
-	for (const auto& element : elements) {
-		m_ast = element.second;
-		m_env = env;
-		ValuePtr element_node = evalImpl();
-		if (element_node == nullptr) {
+	const auto& elements = valueCast<HashMap>(ast)->elements();
+	std::vector<std::pair<ExecutablePtr, ExecutablePtr>> analyzed_elements;
+	analyzed_elements.reserve(elements.size());
+	for (const auto& [key, value] : elements) {
+		auto analyzed_key = analyze(key, scope, false);
+		if (analyzed_key == nullptr) {
+			return nullptr;
+		}
+		auto analyzed_value = analyze(value, scope, false);
+		if (analyzed_value == nullptr) {
 			return nullptr;
 		}
-		evaluated_elements.insert_or_assign(element.first, element_node);
+		analyzed_elements.emplace_back(std::move(analyzed_key), std::move(analyzed_value));
+	}
+
+	return std::make_shared<HashMapNode>(std::move(analyzed_elements));
+}
+
+ExecutablePtr Eval::analyzeCall(const ValuePtr& ast, const ScopePtr& scope, bool tail)
+{
+	auto intrinsic = analyzeIntrinsic(ast, scope, tail);
+	if (intrinsic) {
+		return intrinsic;
+	}
+
+	auto function = analyze(valueCast<List>(ast)->front(), scope, false);
+	if (function == nullptr) {
+		return nullptr;
+	}
+
+	return std::make_shared<CallNode>(ast, std::move(function), tail);
+}
+
+ExecutablePtr Eval::analyzeIntrinsic(const ValuePtr& ast, const ScopePtr& scope, bool tail)
+{
+	auto list = valueCast<List>(ast);
+	if (!is<Symbol>(list->front())) {
+		return nullptr;
+	}
+
+	// Only when the Symbol refers to the global builtin, not to a local
+	uint32_t symbol = valueCast<Symbol>(list->front())->id();
+	if (!isIntrinsic(symbol, list->size() - 1)
+	    || Scope::resolve(scope.get(), symbol).slot != Scope::Address::Global) {
+		return nullptr;
+	}
+
+	return std::make_shared<IntrinsicNode>(ast, symbol, tail);
+}
+
+// -----------------------------------------
+
+bool Eval::isIntrinsic(uint32_t symbol, size_t count)
+{
+	if (!Symbol::isIntrinsic(symbol) || Environment::isRebound(symbol)) {
+		return false;
 	}
 
-	return makePtr<HashMap>(evaluated_elements);
+	return count == ((symbol == Symbol::Not || symbol == Symbol::IsNil) ? 1 : 2);
+}
+
+ValuePtr Eval::intrinsic(uint32_t symbol, const ValuePtr* arguments)
+{
+	const auto& lhs = arguments[0];
+	switch (symbol) {
+	case Symbol::Not:
+		return makePtr<Constant>(is<Constant>(lhs) && valueCast<Constant>(lhs)->state() != Constant::True);
+	case Symbol::IsNil:
+		return makePtr<Constant>(is<Constant>(lhs) && valueCast<Constant>(lhs)->state() == Constant::Nil);
+	default:
+		break;
+	}
+
+	const auto& rhs = arguments[1];
+	if (!lhs.isInteger() || !rhs.isInteger()) {
+		return nullptr;
+	}
+
+	int64_t a = lhs.number();
+	int64_t b = rhs.number();
+	switch (symbol) {
+	case Symbol::Add:
+		return makePtr<Number>(a + b);
+	case Symbol::Subtract:
+		return makePtr<Number>(a - b);
+	case Symbol::Multiply:
+		return makePtr<Number>(a * b);
+	case Symbol::Divide:
+		return (b != 0) ? makePtr<Number>(a / b) : nullptr;
+	case Symbol::Modulo:
+		return (b != 0) ? makePtr<Number>(a % b) : nullptr;
+	case Symbol::Less:
+		return makePtr<Constant>(a < b);
+	case Symbol::LessEqual:
+		return makePtr<Constant>(a <= b);
+	case Symbol::Greater:
+		return makePtr<Constant>(a > b);
+	case Symbol::GreaterEqual:
+		return makePtr<Constant>(a >= b);
+	case Symbol::Equal:
+		return makePtr<Constant>(a == b);
+	default:
+		return nullptr;
+	}
 }
 
 // -----------------------------------------
 
-ValuePtr Eval::apply(ValuePtr function, const ValueVector& nodes)
+ValuePtr Eval::apply(const ValuePtr& function, ValueVector&& arguments)
 {
-	if (!is<Function>(function.get())) {
+	if (is<Lambda>(function) || is<Macro>(function)) {
+		auto env = Environment::create(function, std::move(arguments));
+		return (env) ? run(function, std::move(env)) : nullptr;
+	}
+
+	if (!is<Function>(function)) {
 		Error::the().add(::format("invalid function: {}", function));
 		return nullptr;
 	}
 
-	auto func = std::static_pointer_cast<Function>(function)->function();
+	return valueCast<Function>(function)->call(arguments);
+}
+
+ValuePtr Eval::expand(const ValuePtr& macro, ValueVector&& arguments)
+{
+	auto env = Environment::create(macro, std::move(arguments));
+	return (env) ? run(macro, std::move(env)) : nullptr;
+}
+
+// Lambdas created by the VM are analyzed on their first call
+static Executable* executable(const ValuePtr& lambda)
+{
+	auto function = valueCast<Lambda>(lambda);
+	if (function->executable() == nullptr) {
+		auto executable = Eval::analyze(function->body(), function->scope(), true);
+		if (executable == nullptr) {
+			return nullptr;
+		}
+		function->setExecutable(executable);
+	}
+
+	return function->executable();
+}
 
-	return func(nodes.begin(), nodes.end());
+ValuePtr Eval::run(ValuePtr lambda, EnvironmentPtr env)
+{
+	while (true) {
+		auto body = executable(lambda);
+		if (body == nullptr) {
+			return nullptr;
+		}
+
+		auto result = body->execute(env);
+		if (s_tail_lambda == nullptr) {
+			return result;
+		}
+
+		lambda = std::move(s_tail_lambda);
+		env = std::move(s_tail_env);
+	}
+}
+
+void Eval::tailCall(ValuePtr lambda, EnvironmentPtr env)
+{
+	s_tail_lambda = std::move(lambda);
+	s_tail_env = std::move(env);
 }
 
 } // namespace blaze
@@ -6,9 +6,12 @@
 
 #pragma once
 
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t
+#include <string_view>
 #include <vector>
 
-#include "blaze/forward.h" // EnvironmentPtr
+#include "blaze/forward.h" // EnvironmentPtr, ExecutablePtr, ScopePtr
 
 namespace blaze {
 
@@ -19,47 +22,101 @@ struct SpecialFormParts {
 	std::string_view documentation;
 };
 
+// A form that has been analyzed once, so that it can be executed many times
+// without looking at the syntax again
+class Executable {
+public:
+	virtual ~Executable() = default;
+
+	virtual ValuePtr execute(const EnvironmentPtr& env) = 0;
+
+protected:
+	Executable() = default;
+};
+
+// Analyzing evaluator, every form is first turned into a tree of Executables
+// with the special forms and their arguments already resolved, which is then
+// executed in the environment.
+// https://mitp-content-server.mit.edu/books/content/sectbyfn/books_pres_0/6515/sicp.zip/full-text/book/book-Z-H-26.html#%_sec_4.1.7
 class Eval {
 public:
 	Eval(ValuePtr ast, EnvironmentPtr env);
 	virtual ~Eval() = default;
 
 	static void registerSpecialForm(SpecialFormParts special_form_parts);
+	static const std::vector<SpecialFormParts>& specialFormParts() { return s_special_form_parts; }
+
+	// Symbols are resolved against the Scope the form will be executed in.
+	// Forms in tail position hand their call to the enclosing run() instead of
+	// growing the C++ stack, see tailCall()
+	static ExecutablePtr analyze(const ValuePtr& ast, const ScopePtr& scope, bool tail);
+
+	// Call a Function or Lambda with evaluated arguments
+	static ValuePtr apply(const ValuePtr& function, ValueVector&& arguments);
+	// Call a Macro with the unevaluated arguments, returning the expansion
+	static ValuePtr expand(const ValuePtr& macro, ValueVector&& arguments);
+
+	// Number of macro calls that reused the expansion cached at their call
+	// site instead of running the Macro again
+	static size_t expansionsSaved() { return s_expansions_saved; }
+	static void countSavedExpansion() { ++s_expansions_saved; }
+
+	// Calls of + - * / % < <= > >= = with 2 arguments and of not and nil? with
+	// 1 argument run inline, as long as the Symbol is not rebound. The fast
+	// path handles fixnums, nullptr means the builtin has to run instead.
+	static bool isIntrinsic(uint32_t symbol, size_t count);
+	static ValuePtr intrinsic(uint32_t symbol, const ValuePtr* arguments);
+
+	// Rewrite the argument of a quasiquote into the forms that build it
+	static ValuePtr quasiQuote(const ValuePtr& ast);
+	// The argument of a (symbol x) form, nullptr if ast is not one
+	static ValuePtr startsWith(const ValuePtr& ast, uint32_t symbol);
+	// Parts of a quasiquote without unquotes build the same value every time
+	static bool isQuasiQuoteConstant(const ValuePtr& ast);
+
+	// Execute the body of a Lambda, looping as long as it makes tail calls
+	static ValuePtr run(ValuePtr lambda, EnvironmentPtr env);
+	// Schedule the body of a Lambda to run in place of the current one, the
+	// caller returns nullptr to the enclosing run()
+	static void tailCall(ValuePtr lambda, EnvironmentPtr env);
 
 	void eval();
 
 	ValuePtr ast() const { return m_ast; }
 
 private:
-	ValuePtr evalImpl();
-	ValuePtr evalSymbol(ValuePtr ast, EnvironmentPtr env);
-	ValuePtr evalVector(ValuePtr ast, EnvironmentPtr env);
-	ValuePtr evalHashMap(ValuePtr ast, EnvironmentPtr env);
-
-	ValuePtr evalDef(const ValueVector& nodes, EnvironmentPtr env);
-	ValuePtr evalDefMacro(const ValueVector& nodes, EnvironmentPtr env);
-	ValuePtr evalDescribe(const ValueVector& nodes, EnvironmentPtr env);
-	ValuePtr evalFn(const ValueVector& nodes, EnvironmentPtr env);
-	ValuePtr evalQuasiQuoteExpand(const ValueVector& nodes);
-	ValuePtr evalQuote(const ValueVector& nodes);
-	ValuePtr evalTry(const ValueVector& nodes, EnvironmentPtr env);
-
-	void evalAnd(const ValueVector& nodes, EnvironmentPtr env);
-	void evalDo(const ValueVector& nodes, EnvironmentPtr env);
-	void evalIf(const ValueVector& nodes, EnvironmentPtr env);
-	void evalLet(const ValueVector& nodes, EnvironmentPtr env);
-	void evalMacroExpand1(const ValueVector& nodes, EnvironmentPtr env);
-	void evalOr(const ValueVector& nodes, EnvironmentPtr env);
-	void evalQuasiQuote(const ValueVector& nodes, EnvironmentPtr env);
-	void evalWhile(const ValueVector& nodes, EnvironmentPtr env);
-
-	ValuePtr apply(ValuePtr function, const ValueVector& nodes);
+	static ExecutablePtr analyzeSymbol(const ValuePtr& ast, const ScopePtr& scope);
+	static ExecutablePtr analyzeVector(const ValuePtr& ast, const ScopePtr& scope);
+	static ExecutablePtr analyzeHashMap(const ValuePtr& ast, const ScopePtr& scope);
+	static ExecutablePtr analyzeCall(const ValuePtr& ast, const ScopePtr& scope, bool tail);
+	static ExecutablePtr analyzeIntrinsic(const ValuePtr& ast, const ScopePtr& scope, bool tail);
+
+	static ExecutablePtr analyzeDef(ValueSpan nodes, const ScopePtr& scope);
+	static ExecutablePtr analyzeDefMacro(ValueSpan nodes, const ScopePtr& scope);
+	static ExecutablePtr analyzeDescribe(ValueSpan nodes);
+	static ExecutablePtr analyzeFn(ValueSpan nodes, const ScopePtr& scope);
+	static ExecutablePtr analyzeQuasiQuoteExpand(ValueSpan nodes);
+	static ExecutablePtr analyzeQuote(ValueSpan nodes);
+	static ExecutablePtr analyzeTry(ValueSpan nodes, const ScopePtr& scope);
+
+	static ExecutablePtr analyzeAnd(ValueSpan nodes, const ScopePtr& scope);
+	static ExecutablePtr analyzeDo(ValueSpan nodes, const ScopePtr& scope, bool tail);
+	static ExecutablePtr analyzeIf(ValueSpan nodes, const ScopePtr& scope, bool tail);
+	static ExecutablePtr analyzeLet(ValueSpan nodes, const ScopePtr& scope, bool tail);
+	static ExecutablePtr analyzeMacroExpand1(ValueSpan nodes);
+	static ExecutablePtr analyzeOr(ValueSpan nodes, const ScopePtr& scope);
+	static ExecutablePtr analyzeQuasiQuote(ValueSpan nodes, const ScopePtr& scope, bool tail);
+	static ExecutablePtr analyzeWhile(ValueSpan nodes, const ScopePtr& scope);
 
 	ValuePtr m_ast;
 	EnvironmentPtr m_env;
-	EnvironmentPtr m_outer_env;
 
 	static std::vector<SpecialFormParts> s_special_form_parts;
+	static size_t s_expansions_saved;
+
+	// Pending tail call
+	static ValuePtr s_tail_lambda;
+	static EnvironmentPtr s_tail_env;
 };
 
 } // namespace blaze
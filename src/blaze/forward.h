@@ -7,8 +7,11 @@
 #pragma once
 
 #include <memory> // std::shared_ptr
+#include <span>
 #include <vector>
 
+#include "blaze/value-ptr.h"
+
 namespace blaze {
 
 // -----------------------------------------
@@ -16,16 +19,27 @@ namespace blaze {
 
 class Value;
 class HashMap;
-typedef std::shared_ptr<Value> ValuePtr;
-typedef std::shared_ptr<HashMap> HashMapPtr;
+typedef ValuePtr HashMapPtr;
 typedef std::vector<ValuePtr> ValueVector;
 typedef ValueVector::iterator ValueVectorIt;
 typedef ValueVector::reverse_iterator ValueVectorReverseIt;
 typedef ValueVector::const_iterator ValueVectorConstIt;
 typedef ValueVector::const_reverse_iterator ValueVectorConstReverseIt;
+typedef std::span<const ValuePtr> ValueSpan;
+typedef ValueSpan::iterator ValueSpanIt;
+typedef ValueSpan::reverse_iterator ValueSpanReverseIt;
 
 class Environment;
-typedef std::shared_ptr<Environment> EnvironmentPtr;
+typedef RefPtr<Environment> EnvironmentPtr;
+
+class Scope;
+typedef std::shared_ptr<Scope> ScopePtr;
+
+class Executable;
+typedef std::shared_ptr<Executable> ExecutablePtr;
+
+class Chunk;
+typedef std::shared_ptr<Chunk> ChunkPtr;
 
 class Readline;
 
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2023 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <cstddef> // size_t
+#include <cstdint> // uintptr_t
+#include <cstdlib> // std::aligned_alloc, std::free
+#include <new>     // std::bad_alloc
+
+#include "blaze/nursery.h"
+
+namespace blaze {
+
+// Trivial types only, objects are still freed during static destruction
+Nursery::Block* Nursery::s_current = nullptr;
+char* Nursery::s_top = nullptr;
+char* Nursery::s_end = nullptr;
+Nursery::Block* Nursery::s_free = nullptr;
+size_t Nursery::s_free_count = 0;
+size_t Nursery::s_blocks = 0;
+size_t Nursery::s_regions = 0;
+
+void* Nursery::allocate(size_t size)
+{
+	size = align(size);
+	if (size > s_max_object_size) {
+		return ::operator new(size);
+	}
+
+	if (s_top == nullptr || s_end - s_top < static_cast<std::ptrdiff_t>(size)) {
+		nextBlock();
+	}
+
+	void* pointer = s_top;
+	s_top += size;
+	s_current->live++;
+
+	return pointer;
+}
+
+void Nursery::deallocate(void* pointer, size_t size)
+{
+	if (align(size) > s_max_object_size) {
+		::operator delete(pointer);
+		return;
+	}
+
+	Block* block = blockOf(pointer);
+	if (--block->live > 0) {
+		return;
+	}
+
+	// Everything in the current block died, start over at the beginning
+	if (block == s_current) {
+		s_top = reinterpret_cast<char*>(block) + s_header_size;
+		return;
+	}
+
+	release(block);
+}
+
+// -----------------------------------------
+
+Nursery::Block* Nursery::blockOf(void* pointer)
+{
+	return reinterpret_cast<Block*>(reinterpret_cast<uintptr_t>(pointer) & ~(s_block_size - 1));
+}
+
+void Nursery::nextBlock()
+{
+	// The current block stays in use until its last object is freed, which
+	// hands it to release()
+	Block* block = s_free;
+	if (block != nullptr) {
+		s_free = block->next;
+		s_free_count--;
+	}
+	else {
+		block = static_cast<Block*>(std::aligned_alloc(s_block_size, s_block_size));
+		if (block == nullptr) {
+			throw std::bad_alloc();
+		}
+		s_blocks++;
+	}
+
+	block->next = nullptr;
+	block->live = 0;
+
+	s_current = block;
+	s_top = reinterpret_cast<char*>(block) + s_header_size;
+	s_end = reinterpret_cast<char*>(block) + s_block_size;
+}
+
+void Nursery::release(Block* block)
+{
+	// Within a Region the block is likely needed again soon
+	if (s_regions == 0 || s_free_count >= s_max_free_blocks) {
+		std::free(block);
+		s_blocks--;
+		return;
+	}
+
+	block->next = s_free;
+	s_free = block;
+	s_free_count++;
+}
+
+void Nursery::trim()
+{
+	while (s_free != nullptr) {
+		Block* block = s_free;
+		s_free = block->next;
+		std::free(block);
+		s_blocks--;
+	}
+	s_free_count = 0;
+}
+
+} // namespace blaze
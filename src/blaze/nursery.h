@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2023 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t
+
+namespace blaze {
+
+// Bump allocator for the RefCounted objects, enabled with BLAZE_NURSERY
+//
+// Most objects die young: argument lists, intermediate results, the
+// Environment of a call. They are carved out of the current block by moving a
+// pointer, freeing only counts down the live objects of their block. A block
+// that runs empty is reused as a whole, so short-lived objects keep hitting
+// the same memory instead of going through malloc.
+//
+// Objects are never moved, a long-lived object keeps its block alive until it
+// is freed. Reference counting still decides when an object is dead, the
+// Collector still frees the cycles. Not thread-safe.
+class Nursery {
+public:
+	// Scope of a single top-level evaluation. Once the outermost Region ends,
+	// whatever the evaluation allocated is either freed or still referenced,
+	// from a global or an atom. The blocks it emptied are handed back to the
+	// system in one go, only the blocks holding the survivors are kept.
+	class Region {
+	public:
+		Region() { s_regions++; }
+		~Region()
+		{
+			if (--s_regions == 0) {
+				trim();
+			}
+		}
+
+		Region(const Region&) = delete;
+		Region& operator=(const Region&) = delete;
+	};
+
+	static void* allocate(size_t size);
+	static void deallocate(void* pointer, size_t size);
+
+	// Number of blocks taken from the system that are still held
+	static size_t blocks() { return s_blocks; }
+
+	static constexpr size_t s_block_size = 64 * 1024;
+	static constexpr size_t s_max_object_size = 512;
+
+private:
+	struct Block {
+		Block* next;
+		uint32_t live; // Number of objects not yet freed
+	};
+
+	static constexpr size_t s_alignment = alignof(std::max_align_t);
+	static constexpr size_t s_header_size = (sizeof(Block) + s_alignment - 1) & ~(s_alignment - 1);
+	static constexpr size_t s_max_free_blocks = 16;
+
+	static size_t align(size_t size) { return (size + s_alignment - 1) & ~(s_alignment - 1); }
+
+	static Block* blockOf(void* pointer);
+	static void nextBlock();
+	static void release(Block* block);
+	static void trim();
+
+	static Block* s_current;
+	static char* s_top;
+	static char* s_end;
+	static Block* s_free;
+	static size_t s_free_count;
+	static size_t s_blocks;
+	static size_t s_regions;
+};
+
+} // namespace blaze
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2023 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <cstddef> // size_t
+#include <cstdlib> // std::malloc
+#include <new>     // std::bad_alloc
+
+#include "blaze/pool.h"
+
+namespace blaze {
+
+// Trivial types only, objects are still freed during static destruction
+thread_local std::array<Pool::FreeObject*, Pool::s_size_classes> Pool::s_free {};
+thread_local char* Pool::s_top = nullptr;
+thread_local char* Pool::s_end = nullptr;
+thread_local Pool::Stats Pool::s_stats {};
+
+void* Pool::allocate(size_t size)
+{
+	if (size == 0 || size > s_max_object_size) {
+		s_stats.misses++;
+		return ::operator new(size);
+	}
+
+	size_t size_class = sizeClass(size);
+	size_t class_size = (size_class + 1) * s_granularity;
+
+	FreeObject* object = s_free[size_class];
+	if (object != nullptr) {
+		s_free[size_class] = object->next;
+		s_stats.hits++;
+		s_stats.retained -= class_size;
+		return object;
+	}
+
+	s_stats.misses++;
+	return carve(class_size);
+}
+
+void Pool::deallocate(void* pointer, size_t size)
+{
+	if (size == 0 || size > s_max_object_size) {
+		::operator delete(pointer);
+		return;
+	}
+
+	size_t size_class = sizeClass(size);
+
+	auto object = static_cast<FreeObject*>(pointer);
+	object->next = s_free[size_class];
+	s_free[size_class] = object;
+	s_stats.retained += (size_class + 1) * s_granularity;
+}
+
+Pool::Stats Pool::stats()
+{
+	return s_stats;
+}
+
+// -----------------------------------------
+
+void* Pool::carve(size_t size)
+{
+	// The tail of the previous slab is too small, it is lost
+	if (s_end - s_top < static_cast<std::ptrdiff_t>(size)) {
+		auto slab = static_cast<char*>(std::malloc(s_slab_size));
+		if (slab == nullptr) {
+			throw std::bad_alloc();
+		}
+		s_stats.retained -= s_end - s_top;
+		s_stats.retained += s_slab_size;
+		s_stats.slabs++;
+
+		s_top = slab;
+		s_end = slab + s_slab_size;
+	}
+
+	void* pointer = s_top;
+	s_top += size;
+	s_stats.retained -= size;
+
+	return pointer;
+}
+
+} // namespace blaze
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2023 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef> // size_t
+
+namespace blaze {
+
+// Size-class free lists for the RefCounted objects
+//
+// Values and Environments come in a handful of small, fixed sizes and are
+// allocated and freed at a very high rate. A freed object is pushed onto the
+// free list of its size class and handed out again to the next allocation of
+// that size. New objects are carved out of large slabs, so only the slabs go
+// through malloc.
+//
+// The free lists are per thread, an object freed on another thread is simply
+// reused there. Memory is retained for the lifetime of the process.
+class Pool {
+public:
+	struct Stats {
+		size_t hits;     // Allocations served from a free list
+		size_t misses;   // Allocations carved out of a slab, or too large to pool
+		size_t retained; // Bytes held in free lists and unused slab space
+		size_t slabs;    // Slabs allocated with malloc
+	};
+
+	static void* allocate(size_t size);
+	static void deallocate(void* pointer, size_t size);
+
+	// Statistics of the calling thread
+	static Stats stats();
+
+	static constexpr size_t s_slab_size = 64 * 1024;
+	static constexpr size_t s_max_object_size = 256;
+
+private:
+	struct FreeObject {
+		FreeObject* next;
+	};
+
+	static constexpr size_t s_granularity = alignof(std::max_align_t);
+	static constexpr size_t s_size_classes = s_max_object_size / s_granularity;
+
+	static size_t sizeClass(size_t size) { return (size - 1) / s_granularity; }
+	static void* carve(size_t size);
+
+	static thread_local std::array<FreeObject*, s_size_classes> s_free;
+	static thread_local char* s_top;
+	static thread_local char* s_end;
+	static thread_local Stats s_stats;
+};
+
+} // namespace blaze
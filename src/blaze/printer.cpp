@@ -5,8 +5,8 @@
  */
 
 #include <iterator> // std::next
-#include <memory>   // std::static_pointer_cast
 #include <string>
+#include <utility> // std::exchange
 
 #include "ruc/format/color.h"
 #include "ruc/format/format.h"
@@ -31,7 +31,7 @@ Printer::~Printer()
 
 // -----------------------------------------
 
-std::string Printer::print(ValuePtr value, bool print_readably)
+std::string Printer::print(const ValuePtr& value, bool print_readably)
 {
 	if (Error::the().hasAnyError()) {
 		init();
@@ -42,7 +42,7 @@ std::string Printer::print(ValuePtr value, bool print_readably)
 	return printNoErrorCheck(value, print_readably);
 }
 
-std::string Printer::printNoErrorCheck(ValuePtr value, bool print_readably)
+std::string Printer::printNoErrorCheck(const ValuePtr& value, bool print_readably)
 {
 	init();
 
@@ -64,7 +64,7 @@ void Printer::init()
 	m_print = "";
 }
 
-void Printer::printImpl(ValuePtr value, bool print_readably)
+void Printer::printImpl(const ValuePtr& value, bool print_readably)
 {
 	bool pretty_print = Settings::the().getEnvBool("*PRETTY-PRINT*");
 
@@ -74,27 +74,35 @@ void Printer::printImpl(ValuePtr value, bool print_readably)
 		}
 	};
 
-	Value* value_raw_ptr = value.get();
-	if (is<Collection>(value_raw_ptr)) {
+	if (is<Collection>(value)) {
 		printSpacing();
-		m_print += (is<List>(value_raw_ptr)) ? '(' : '[';
+		m_print += (is<List>(value)) ? '(' : '[';
 		m_first_node = false;
 		m_previous_node_is_list = true;
-		auto nodes = std::static_pointer_cast<Collection>(value)->nodesRead();
-		for (auto node : nodes) {
+		auto nodes = valueCast<Collection>(value)->nodesRead();
+		for (const auto& node : nodes) {
 			printImpl(node, print_readably);
 			m_previous_node_is_list = false;
 		}
-		m_print += (is<List>(value_raw_ptr)) ? ')' : ']';
+		m_print += (is<List>(value)) ? ')' : ']';
 	}
-	else if (is<HashMap>(value_raw_ptr)) {
+	else if (is<HashMap>(value)) {
 		printSpacing();
 		m_print += "{";
 		m_first_node = false;
 		m_previous_node_is_list = true;
-		auto elements = std::static_pointer_cast<HashMap>(value)->elements();
+		const auto& elements = valueCast<HashMap>(value)->elements();
 		for (auto it = elements.begin(); it != elements.end(); ++it) {
-			m_print += ::format("{} ", (it->first.front() == 0x7f) ? ":" + it->first.substr(1) : '"' + it->first + '"'); // 127
+			if (is<Keyword>(it->first) || is<String>(it->first)) {
+				m_print += ::format("{} ", is<Keyword>(it->first) ? ":" + valueCast<Keyword>(it->first)->keyword() : '"' + valueCast<String>(it->first)->data() + '"');
+			}
+			else {
+				// Other keys are printed like any value, without spacing in front
+				bool previous_node_is_list = std::exchange(m_previous_node_is_list, true);
+				printImpl(it->first, print_readably);
+				m_previous_node_is_list = previous_node_is_list;
+				m_print += ' ';
+			}
 			printImpl(it->second, print_readably);
 
 			if (!isLast(it, elements)) {
@@ -104,8 +112,8 @@ void Printer::printImpl(ValuePtr value, bool print_readably)
 		m_previous_node_is_list = false;
 		m_print += '}';
 	}
-	else if (is<String>(value_raw_ptr)) {
-		std::string text = std::static_pointer_cast<String>(value)->data();
+	else if (is<String>(value)) {
+		std::string text = valueCast<String>(value)->data();
 		if (print_readably) {
 			text = replaceAll(text, "\\", "\\\\");
 			text = replaceAll(text, "\"", "\\\"");
@@ -120,48 +128,48 @@ void Printer::printImpl(ValuePtr value, bool print_readably)
 			m_print += ::format("{}", text);
 		}
 	}
-	else if (is<Keyword>(value_raw_ptr)) {
+	else if (is<Keyword>(value)) {
 		printSpacing();
-		m_print += ::format(":{}", std::static_pointer_cast<Keyword>(value)->keyword().substr(1));
+		m_print += ::format(":{}", valueCast<Keyword>(value)->keyword());
 	}
-	else if (is<Number>(value_raw_ptr)) {
+	else if (is<Number>(value)) {
 		printSpacing();
-		m_print += ::format("{}", std::static_pointer_cast<Number>(value)->number());
+		m_print += ::format("{}", valueCast<Number>(value)->number());
 	}
-	else if (is<Decimal>(value_raw_ptr)) {
+	else if (is<Decimal>(value)) {
 		printSpacing();
-		m_print += ::format("{:.15}", std::static_pointer_cast<Decimal>(value)->decimal());
+		m_print += ::format("{:.15}", valueCast<Decimal>(value)->decimal());
 	}
-	else if (is<Constant>(value_raw_ptr)) {
+	else if (is<Constant>(value)) {
 		printSpacing();
 		std::string constant;
-		switch (std::static_pointer_cast<Constant>(value)->state()) {
+		switch (valueCast<Constant>(value)->state()) {
 		case Constant::Nil: constant = "nil"; break;
 		case Constant::True: constant = "true"; break;
 		case Constant::False: constant = "false"; break;
 		}
 		m_print += ::format("{}", constant);
 	}
-	else if (is<Symbol>(value_raw_ptr)) {
+	else if (is<Symbol>(value)) {
 		printSpacing();
-		m_print += ::format("{}", std::static_pointer_cast<Symbol>(value)->symbol());
+		m_print += ::format("{}", valueCast<Symbol>(value)->symbol());
 	}
-	else if (is<Function>(value_raw_ptr)) {
+	else if (is<Function>(value)) {
 		printSpacing();
-		m_print += ::format("#<builtin-function>({})", std::static_pointer_cast<Function>(value)->name());
+		m_print += ::format("#<builtin-function>({})", valueCast<Function>(value)->name());
 	}
-	else if (is<Lambda>(value_raw_ptr)) {
+	else if (is<Lambda>(value)) {
 		printSpacing();
-		m_print += ::format("#<user-function>({:p})", value_raw_ptr);
+		m_print += ::format("#<user-function>({:p})", value.get());
 	}
-	else if (is<Macro>(value_raw_ptr)) {
+	else if (is<Macro>(value)) {
 		printSpacing();
-		m_print += ::format("#<user-macro>({:p})", value_raw_ptr);
+		m_print += ::format("#<user-macro>({:p})", value.get());
 	}
-	else if (is<Atom>(value_raw_ptr)) {
+	else if (is<Atom>(value)) {
 		printSpacing();
 		m_print += "(atom ";
-		printImpl(std::static_pointer_cast<Atom>(value)->deref(), print_readably);
+		printImpl(valueCast<Atom>(value)->deref(), print_readably);
 		m_print += ")";
 	}
 }
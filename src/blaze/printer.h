@@ -18,12 +18,12 @@ public:
 	Printer();
 	virtual ~Printer();
 
-	std::string print(ValuePtr value, bool print_readably = true);
-	std::string printNoErrorCheck(ValuePtr value, bool print_readably = true);
+	std::string print(const ValuePtr& value, bool print_readably = true);
+	std::string printNoErrorCheck(const ValuePtr& value, bool print_readably = true);
 
 private:
 	void init();
-	void printImpl(ValuePtr value, bool print_readably = true);
+	void printImpl(const ValuePtr& value, bool print_readably = true);
 	void printError();
 
 	bool m_first_node { true };
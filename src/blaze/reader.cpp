@@ -8,7 +8,6 @@
 #include <cstddef>      // size_t
 #include <cstdint>      // uint64_t
 #include <cstdlib>      // std::strtoll
-#include <memory>       // std::static_pointer_cast
 #include <system_error> // std::errc
 #include <utility>      // std::move
 
@@ -130,7 +129,7 @@ ValuePtr Reader::readSpliceUnquote()
 	}
 
 	auto nodes = ValueVector(2);
-	nodes.at(0) = makePtr<Symbol>("splice-unquote");
+	nodes.at(0) = Symbol::create(Symbol::SpliceUnquote);
 	nodes.at(1) = readImpl();
 
 	return makePtr<List>(nodes);
@@ -194,13 +193,8 @@ ValuePtr Reader::readHashMap()
 			return nullptr;
 		}
 
-		if (!is<String>(key.get()) && !is<Keyword>(key.get())) {
-			Error::the().add(::format("wrong argument type: string or keyword, {}", key));
-			return nullptr;
-		}
-
 		auto value = readImpl();
-		elements.insert_or_assign(HashMap::getKeyString(key), value);
+		elements.insert_or_assign(key, value);
 	}
 
 	if (!consumeSpecific(Token { .type = Token::Type::BraceClose, .symbol = "" })) { // }
@@ -221,7 +215,7 @@ ValuePtr Reader::readQuote()
 	}
 
 	auto nodes = ValueVector(2);
-	nodes.at(0) = makePtr<Symbol>("quote");
+	nodes.at(0) = Symbol::create(Symbol::Quote);
 	nodes.at(1) = readImpl();
 
 	return makePtr<List>(nodes);
@@ -237,7 +231,7 @@ ValuePtr Reader::readQuasiQuote()
 	}
 
 	auto nodes = ValueVector(2);
-	nodes.at(0) = makePtr<Symbol>("quasiquote");
+	nodes.at(0) = Symbol::create(Symbol::QuasiQuote);
 	nodes.at(1) = readImpl();
 
 	return makePtr<List>(nodes);
@@ -253,7 +247,7 @@ ValuePtr Reader::readUnquote()
 	}
 
 	auto nodes = ValueVector(2);
-	nodes.at(0) = makePtr<Symbol>("unquote");
+	nodes.at(0) = Symbol::create(Symbol::Unquote);
 	nodes.at(1) = readImpl();
 
 	return makePtr<List>(nodes);
@@ -271,7 +265,7 @@ ValuePtr Reader::readWithMeta()
 	retreat();
 
 	auto nodes = ValueVector(3);
-	nodes.at(0) = makePtr<Symbol>("with-meta");
+	nodes.at(0) = Symbol::create(Symbol::WithMeta);
 	nodes.at(2) = readImpl(); // Note: second Value is read first
 	nodes.at(1) = readImpl();
 
@@ -288,7 +282,7 @@ ValuePtr Reader::readDeref()
 	}
 
 	auto nodes = ValueVector(2);
-	nodes.at(0) = makePtr<Symbol>("deref");
+	nodes.at(0) = Symbol::create(Symbol::Deref);
 	nodes.at(1) = readImpl();
 
 	return makePtr<List>(nodes);
@@ -303,7 +297,7 @@ ValuePtr Reader::readString()
 
 ValuePtr Reader::readKeyword()
 {
-	return makePtr<Keyword>(consume().symbol);
+	return Keyword::create(consume().symbol);
 }
 
 ValuePtr Reader::readValue()
@@ -334,7 +328,7 @@ ValuePtr Reader::readValue()
 		return makePtr<Constant>(Constant::False);
 	}
 
-	return makePtr<Symbol>(symbol);
+	return Symbol::create(symbol);
 }
 
 // -----------------------------------------
@@ -378,13 +372,13 @@ void Reader::retreat()
 
 // -----------------------------------------
 
-void Reader::dump(ValuePtr node)
+void Reader::dump(const ValuePtr& node)
 {
 	m_indentation = 0;
 	dumpImpl((node != nullptr) ? node : m_node);
 }
 
-void Reader::dumpImpl(ValuePtr node)
+void Reader::dumpImpl(const ValuePtr& node)
 {
 	std::string indentation = std::string(m_indentation * INDENTATION_WIDTH, ' ');
 	print("{}", indentation);
@@ -393,36 +387,32 @@ void Reader::dumpImpl(ValuePtr node)
 	auto blue = fg(ruc::format::TerminalColor::BrightBlue);
 	auto yellow = fg(ruc::format::TerminalColor::Yellow);
 
-	Value* node_raw_ptr = node.get();
-	if (is<Collection>(node_raw_ptr)) {
-		auto container = (is<List>(node_raw_ptr)) ? "List" : "Vector";
-		auto parens = (is<List>(node_raw_ptr)) ? "()" : "[]";
+	if (is<Collection>(node)) {
+		auto container = (is<List>(node)) ? "List" : "Vector";
+		auto parens = (is<List>(node)) ? "()" : "[]";
 		pretty_print ? print(blue, "{}", container) : print("{}", container);
 		print(" <");
 		pretty_print ? print(blue, "{}", parens) : print("{}", parens);
 		print(">\n");
 		m_indentation++;
-		auto nodes = std::static_pointer_cast<List>(node)->nodesRead();
-		for (auto node : nodes) {
+		auto nodes = valueCast<List>(node)->nodesRead();
+		for (const auto& node : nodes) {
 			dumpImpl(node);
 		}
 		m_indentation--;
 		return;
 	}
-	else if (is<HashMap>(node_raw_ptr)) {
-		auto hash_map = std::static_pointer_cast<HashMap>(node);
-		auto elements = hash_map->elements();
+	else if (is<HashMap>(node)) {
+		auto hash_map = valueCast<HashMap>(node);
+		const auto& elements = hash_map->elements();
 		pretty_print ? print(blue, "HashMap") : print("HashMap");
 		print(" <");
 		pretty_print ? print(blue, "{{}}") : print("{{}}");
 		print(">\n");
 		m_indentation++;
 		ValuePtr key_node = nullptr;
-		for (auto element : elements) {
-			bool is_keyword = element.first.front() == 0x7f; // 127
-			is_keyword
-				? dumpImpl(makePtr<Keyword>(element.first.substr(1)))
-				: dumpImpl(makePtr<String>(element.first));
+		for (const auto& element : elements) {
+			dumpImpl(element.first);
 			m_indentation++;
 			dumpImpl(element.second);
 			m_indentation--;
@@ -430,32 +420,32 @@ void Reader::dumpImpl(ValuePtr node)
 		m_indentation--;
 		return;
 	}
-	else if (is<String>(node_raw_ptr)) {
+	else if (is<String>(node)) {
 		pretty_print ? print(yellow, "StringNode") : print("StringNode");
 		print(" <{}>", node);
 	}
-	else if (is<Keyword>(node_raw_ptr)) {
+	else if (is<Keyword>(node)) {
 		pretty_print ? print(yellow, "KeywordNode") : print("KeywordNode");
 		print(" <{}>", node);
 	}
-	else if (is<Number>(node_raw_ptr)) {
+	else if (is<Number>(node)) {
 		pretty_print ? print(yellow, "NumberNode") : print("NumberNode");
 		print(" <{}>", node);
 	}
-	else if (is<Decimal>(node_raw_ptr)) {
+	else if (is<Decimal>(node)) {
 		pretty_print ? print(yellow, "DecimalNode") : print("DecimalNode");
 		print(" <{}>", node);
 	}
-	else if (is<Constant>(node_raw_ptr)) {
+	else if (is<Constant>(node)) {
 		pretty_print ? print(yellow, "ValueNode") : print("ValueNode");
 		print(" <{}>", node);
 	}
-	else if (is<Symbol>(node_raw_ptr)) {
+	else if (is<Symbol>(node)) {
 		pretty_print ? print(yellow, "SymbolNode") : print("SymbolNode");
 		print(" <{}>", node);
 	}
-	else if (is<Function>(node_raw_ptr)) {
-		auto function = std::static_pointer_cast<Function>(node);
+	else if (is<Function>(node)) {
+		auto function = valueCast<Function>(node);
 		pretty_print ? print(blue, "Function") : print("Function");
 		print(" <");
 		pretty_print ? print(blue, "{}", function->name()) : print("{}", function->name());
@@ -472,12 +462,12 @@ void Reader::dumpImpl(ValuePtr node)
 		m_indentation--;
 		return;
 	}
-	else if (is<Lambda>(node_raw_ptr) || is<Macro>(node_raw_ptr)) {
-		auto container = (is<Lambda>(node_raw_ptr)) ? "Lambda" : "Macro";
-		auto lambda = std::static_pointer_cast<Lambda>(node);
+	else if (is<Lambda>(node) || is<Macro>(node)) {
+		auto container = (is<Lambda>(node)) ? "Lambda" : "Macro";
+		auto lambda = valueCast<Lambda>(node);
 		pretty_print ? print(blue, "{}", container) : print("{}", container);
 		print(" <");
-		pretty_print ? print(blue, "{:p}", node_raw_ptr) : print("{:p}", node_raw_ptr);
+		pretty_print ? print(blue, "{:p}", node.get()) : print("{:p}", node.get());
 		print(">\n");
 
 		m_indentation++;
@@ -489,7 +479,7 @@ void Reader::dumpImpl(ValuePtr node)
 		print(" <");
 		const auto& bindings = lambda->bindings();
 		for (size_t i = 0; i < bindings.size(); ++i) {
-			print("{}{}", (i > 0) ? " " : "", bindings[i]);
+			print("{}{}", (i > 0) ? " " : "", Symbol::find(bindings[i])->symbol());
 		}
 		print(">\n");
 
@@ -499,9 +489,9 @@ void Reader::dumpImpl(ValuePtr node)
 		m_indentation--;
 		return;
 	}
-	else if (is<Atom>(node_raw_ptr)) {
+	else if (is<Atom>(node)) {
 		pretty_print ? print(yellow, "AtomNode") : print("AtomNode");
-		print(" <{}>", std::static_pointer_cast<Atom>(node)->deref());
+		print(" <{}>", valueCast<Atom>(node)->deref());
 	}
 	print("\n");
 }
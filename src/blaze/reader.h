@@ -26,7 +26,7 @@ public:
 
 	void read();
 
-	void dump(ValuePtr node = nullptr);
+	void dump(const ValuePtr& node = nullptr);
 
 	ValuePtr node() { return m_node; }
 
@@ -52,7 +52,7 @@ private:
 	ValuePtr readKeyword();       // :keyword
 	ValuePtr readValue();         // number, "nil", "true", "false", symbol
 
-	void dumpImpl(ValuePtr node);
+	void dumpImpl(const ValuePtr& node);
 
 	size_t m_index { 0 };
 	size_t m_indentation { 0 };
@@ -7,20 +7,25 @@
 #include <cstdlib> // std::exit
 #include <string>
 #include <string_view>
+#include <utility> // std::move
 #include <vector>
 
 #include "ruc/format/print.h"
 
+#include "blaze/ast.h"
 #include "blaze/env/environment.h"
 #include "blaze/error.h"
 #include "blaze/eval.h"
 #include "blaze/forward.h"
 #include "blaze/lexer.h"
+#include "blaze/nursery.h"
 #include "blaze/printer.h"
 #include "blaze/reader.h"
 #include "blaze/readline.h"
 #include "blaze/repl.h"
 #include "blaze/settings.h"
+#include "blaze/types.h"
+#include "blaze/vm/vm.h"
 
 namespace blaze {
 
@@ -66,41 +71,57 @@ auto Repl::read(std::string_view input) -> ValuePtr
 	return reader.node();
 }
 
-auto Repl::eval(ValuePtr ast, EnvironmentPtr env) -> ValuePtr
+auto Repl::apply(const ValuePtr& function, ValueVector&& arguments) -> ValuePtr
 {
-	if (env == nullptr) {
-		env = g_outer_env;
+	// Stay in the engine the Lambda was created by
+	if ((is<Lambda>(function) || is<Macro>(function)) && valueCast<Lambda>(function)->chunk() != nullptr) {
+		return VM::the().apply(function, std::move(arguments));
 	}
 
-	Eval eval(ast, env);
+	return Eval::apply(function, std::move(arguments));
+}
+
+auto Repl::eval(const ValuePtr& ast, const EnvironmentPtr& env) -> ValuePtr
+{
+	Nursery::Region region;
+
+	const auto& environment = (env != nullptr) ? env : g_outer_env;
+
+	if (Settings::the().getEnvBool("*BYTECODE*")) {
+		return VM::the().eval(ast, environment);
+	}
+
+	Eval eval(ast, environment);
 	eval.eval();
 
 	return eval.ast();
 }
 
-auto Repl::print(ValuePtr value) -> std::string
+auto Repl::print(const ValuePtr& value) -> std::string
 {
 	Printer printer;
 
 	return printer.print(value, true);
 }
 
-auto Repl::rep(std::string_view input, EnvironmentPtr env) -> std::string
+auto Repl::rep(std::string_view input, const EnvironmentPtr& env) -> std::string
 {
+	Nursery::Region region;
+
 	Error::the().clearErrors();
 	Error::the().setInput(input);
 
 	return print(eval(read(input), env));
 }
 
-auto Repl::makeArgv(EnvironmentPtr env, std::vector<std::string> arguments) -> void
+auto Repl::makeArgv(const EnvironmentPtr& env, std::vector<std::string> arguments) -> void
 {
 	size_t count = arguments.size();
 	auto nodes = ValueVector();
 	for (size_t i = 1; i < count; ++i) {
 		nodes.push_back(makePtr<String>(arguments[i]));
 	}
-	env->set("*ARGV*", makePtr<List>(nodes));
+	env->set("*ARGV*", makePtr<List>(std::move(nodes)));
 }
 
 } // namespace blaze
@@ -20,12 +20,13 @@ public:
 	static auto init() -> void;
 	static auto cleanup() -> void;
 
-	static auto eval(ValuePtr ast, EnvironmentPtr env) -> ValuePtr;
-	static auto makeArgv(EnvironmentPtr env, std::vector<std::string> arguments) -> void;
-	static auto print(ValuePtr value) -> std::string;
+	static auto apply(const ValuePtr& function, ValueVector&& arguments) -> ValuePtr;
+	static auto eval(const ValuePtr& ast, const EnvironmentPtr& env) -> ValuePtr;
+	static auto makeArgv(const EnvironmentPtr& env, std::vector<std::string> arguments) -> void;
+	static auto print(const ValuePtr& value) -> std::string;
 	static auto read(std::string_view input) -> ValuePtr;
 	static auto readline(const std::string& prompt) -> ValuePtr;
-	static auto rep(std::string_view input, EnvironmentPtr env) -> std::string;
+	static auto rep(std::string_view input, const EnvironmentPtr& env) -> std::string;
 };
 
 } // namespace blaze
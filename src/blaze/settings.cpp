@@ -4,8 +4,6 @@
  * SPDX-License-Identifier: MIT
  */
 
-#include <memory> // std::static_pointer_cast
-
 #include "ruc/meta/assert.h"
 
 #include "blaze/env/environment.h"
@@ -24,7 +22,7 @@ std::string_view Settings::get(std::string_view key) const
 bool Settings::getEnvBool(std::string_view key) const
 {
 	auto env = g_outer_env->get(key);
-	return is<Constant>(env.get()) && std::static_pointer_cast<Constant>(env)->state() == Constant::State::True;
+	return is<Constant>(env) && valueCast<Constant>(env)->state() == Constant::State::True;
 }
 
 } // namespace blaze
@@ -9,7 +9,7 @@
 #include <typeinfo>
 
 template<typename T, typename U>
-inline bool is(U& input)
+inline bool is(const U& input)
 {
 	if constexpr (requires { input.template fastIs<T>(); }) {
 		return input.template fastIs<T>();
@@ -6,7 +6,7 @@
 
 #pragma once
 
-#include <memory> // std::static_pointer_cast
+#include <iterator> // std::next
 #include <string>
 #include <string_view>
 
@@ -107,7 +107,7 @@
 // -----------------------------------------
 
 #define IS_VALUE_IMPL(type, value, result)                                              \
-	if (!is<type>(value.get())) {                                                       \
+	if (!is<type>(value)) {                                                       \
 		blaze::Error::the().add(::format("wrong argument type: {}, {}", #type, value)); \
 		return result;                                                                  \
 	}
@@ -126,7 +126,7 @@
 
 #define VALUE_CAST_IMPL(variable, type, value, result) \
 	IS_VALUE(type, value, result);                     \
-	auto variable = std::static_pointer_cast<type>(value);
+	auto variable = valueCast<type>(value);
 
 #define VALUE_CAST_3(variable, type, value) \
 	VALUE_CAST_IMPL(variable, type, value, nullptr)
@@ -145,7 +145,7 @@ namespace blaze {
 template<typename It, typename C>
 inline bool isLast(It it, const C& container)
 {
-	return (it != container.end()) && (next(it) == container.end());
+	return (it != container.end()) && (std::next(it) == container.end());
 }
 
 inline std::string replaceAll(std::string text, std::string_view search, std::string_view replace)
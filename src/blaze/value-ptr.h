@@ -0,0 +1,344 @@
+/*
+ * Copyright (C) 2023 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <atomic>  // std::atomic_ref
+#include <bit>     // std::bit_cast
+#include <cstddef> // nullptr_t, size_t
+#include <cstdint> // int64_t, uint32_t, uint64_t, uintptr_t
+#include <utility> // std::exchange
+
+#if defined(BLAZE_NURSERY)
+	#include "blaze/nursery.h"
+#else
+	#include "blaze/pool.h"
+#endif
+
+#if __has_include(<sys/single_threaded.h>)
+	#include <sys/single_threaded.h> // __libc_single_threaded
+#endif
+
+namespace blaze {
+
+class Value;
+class Number;
+class Decimal;
+class Constant;
+
+// -----------------------------------------
+
+class Tracer;
+
+// Intrusive reference count, the count lives inside of the object so that a
+// handle only needs to store a single pointer
+//
+// Like libstdc++'s std::shared_ptr, the count is only updated atomically once
+// the process has started a second thread. Building with BLAZE_SINGLE_THREADED
+// drops the atomic path altogether.
+//
+// Counting alone never frees a cycle, like a Lambda stored in the Environment
+// it closes over. Objects that hold references report them through trace(),
+// so that the Collector can find those cycles.
+class RefCounted {
+public:
+	virtual ~RefCounted() = default;
+
+#if defined(BLAZE_NURSERY)
+	static void* operator new(size_t size) { return Nursery::allocate(size); }
+	static void operator delete(void* pointer, size_t size) { Nursery::deallocate(pointer, size); }
+#else
+	static void* operator new(size_t size) { return Pool::allocate(size); }
+	static void operator delete(void* pointer, size_t size) { Pool::deallocate(pointer, size); }
+#endif
+
+	void ref() const
+	{
+		if (isSingleThreaded()) {
+			++m_ref_count;
+			return;
+		}
+		std::atomic_ref(m_ref_count).fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void unref() const
+	{
+		uint32_t count = isSingleThreaded()
+		                     ? m_ref_count--
+		                     : std::atomic_ref(m_ref_count).fetch_sub(1, std::memory_order_acq_rel);
+		if (count == 1) {
+			// The Collector still points to it, it frees the object instead
+			if ((m_gc_flags & Buffered) == 0) {
+				delete this;
+			}
+			return;
+		}
+
+		// Whatever is left could be a cycle
+		if ((m_gc_flags & (Buffered | Leaf)) == 0 && isSingleThreaded()) {
+			possibleRoot();
+		}
+	}
+
+	uint32_t refCount() const { return m_ref_count; }
+
+	// Objects that can be part of a cycle report every RefCounted object they
+	// hold a reference to, and drop those references on clear()
+	virtual bool traceable() const { return false; }
+	virtual void trace(Tracer&) const {}
+	virtual void clear() {}
+
+protected:
+	RefCounted() = default;
+	RefCounted(const RefCounted&) {} // Copies are new objects, dont copy the count
+
+private:
+	friend class Collector;
+
+	enum GcFlags : uint8_t {
+		Buffered = 1 << 0, // In the possible roots of the Collector
+		Leaf = 1 << 1,     // Not traceable, never a possible root
+	};
+
+	static bool isSingleThreaded()
+	{
+#if defined(BLAZE_SINGLE_THREADED)
+		return true;
+#elif __has_include(<sys/single_threaded.h>)
+		return __libc_single_threaded;
+#else
+		return false;
+#endif
+	}
+
+	void possibleRoot() const; // See collector.cpp
+
+	alignas(std::atomic_ref<uint32_t>::required_alignment) mutable uint32_t m_ref_count { 0 };
+	mutable uint8_t m_gc_flags { 0 };
+	mutable uint8_t m_gc_color { 0 };
+};
+
+// Handle to a RefCounted object, used for the types that are not a Value
+template<typename T>
+class RefPtr {
+public:
+	RefPtr() = default;
+	RefPtr(std::nullptr_t) {}
+	RefPtr(T* object)
+		: m_object(object)
+	{
+		ref();
+	}
+
+	RefPtr(const RefPtr& other)
+		: m_object(other.m_object)
+	{
+		ref();
+	}
+
+	RefPtr(RefPtr&& other) noexcept
+		: m_object(std::exchange(other.m_object, nullptr))
+	{
+	}
+
+	~RefPtr() { unref(); }
+
+	// The other handle can live inside of the object that is released, so
+	// read it before releasing
+	RefPtr& operator=(const RefPtr& other)
+	{
+		other.ref();
+		T* object = other.m_object;
+		unref();
+		m_object = object;
+		return *this;
+	}
+
+	RefPtr& operator=(RefPtr&& other) noexcept
+	{
+		T* object = std::exchange(other.m_object, nullptr);
+		unref();
+		m_object = object;
+		return *this;
+	}
+
+	T* get() const { return m_object; }
+	T* operator->() const { return m_object; }
+	T& operator*() const { return *m_object; }
+
+	explicit operator bool() const { return m_object != nullptr; }
+	bool operator==(std::nullptr_t) const { return m_object == nullptr; }
+	bool operator==(const RefPtr& other) const { return m_object == other.m_object; }
+
+private:
+	void ref() const
+	{
+		if (m_object != nullptr) {
+			m_object->ref();
+		}
+	}
+
+	void unref() const
+	{
+		if (m_object != nullptr) {
+			m_object->unref();
+		}
+	}
+
+	T* m_object { nullptr };
+};
+
+// -----------------------------------------
+
+static_assert(sizeof(void*) == 8, "NaN-boxing requires 64-bit pointers");
+
+// NaN-boxed handle to a Value
+//
+// Numbers, decimals and constants are stored inline in the 64-bit word, only
+// the remaining types are allocated on the heap. The top 16 bits decide what
+// the word holds:
+//
+//   0000:xxxx:xxxx:xxxx  pointer to a heap object (0 is nullptr)
+//   0000:0000:0000:0002  nil
+//   0000:0000:0000:0006  false
+//   0000:0000:0000:0007  true
+//   0002:xxxx:xxxx:xxxx  double, stored with 2^49 added to its bits, which
+//   ...                  maps every (canonicalized) double into this range
+//   fffa:xxxx:xxxx:xxxx
+//   fffe:xxxx:xxxx:xxxx  49-bit signed integer, integers that dont fit are
+//   ffff:xxxx:xxxx:xxxx  boxed on the heap
+//
+// https://github.com/WebKit/WebKit/blob/main/Source/JavaScriptCore/runtime/JSCJSValue.h
+class ValuePtr {
+public:
+	ValuePtr() = default;
+	ValuePtr(std::nullptr_t) {}
+	ValuePtr(Value* value);
+	ValuePtr(Number number);
+	ValuePtr(Decimal decimal);
+	ValuePtr(Constant constant);
+
+	ValuePtr(const ValuePtr& other)
+		: m_bits(other.m_bits)
+	{
+		ref();
+	}
+
+	ValuePtr(ValuePtr&& other) noexcept
+		: m_bits(std::exchange(other.m_bits, 0))
+	{
+	}
+
+	~ValuePtr() { unref(); }
+
+	// The other handle can live inside of the object that is released, so
+	// read it before releasing
+	ValuePtr& operator=(const ValuePtr& other)
+	{
+		other.ref();
+		uint64_t bits = other.m_bits;
+		unref();
+		m_bits = bits;
+		return *this;
+	}
+
+	ValuePtr& operator=(ValuePtr&& other) noexcept
+	{
+		uint64_t bits = std::exchange(other.m_bits, 0);
+		unref();
+		m_bits = bits;
+		return *this;
+	}
+
+	bool isObject() const { return m_bits != 0 && (m_bits & s_not_object_mask) == 0; }
+	bool isInteger() const { return (m_bits & s_integer_tag) == s_integer_tag; }
+	bool isDouble() const { return (m_bits & s_integer_tag) != 0 && !isInteger(); }
+	bool isConstant() const { return m_bits != 0 && (m_bits & ~s_constant_mask) == 0; }
+
+	// Unchecked accessors, number() and state() are defined in ast.h
+	int64_t number() const;
+	double decimal() const { return std::bit_cast<double>(m_bits - s_double_offset); }
+	uint8_t state() const;
+
+	Value* get() const;
+	Value* operator->() const { return get(); }
+	Value& operator*() const { return *get(); }
+
+	template<typename T>
+	bool fastIs() const;
+
+	explicit operator bool() const { return m_bits != 0; }
+	bool operator==(std::nullptr_t) const { return m_bits == 0; }
+	bool operator==(const ValuePtr& other) const { return m_bits == other.m_bits; }
+
+	uint64_t bits() const { return m_bits; }
+
+private:
+	friend class Number;
+	friend class Decimal;
+	friend class Constant;
+	friend class Tracer;
+
+	static constexpr uint64_t s_integer_tag = 0xfffe000000000000;
+	static constexpr uint64_t s_other_tag = 0x2;
+	static constexpr uint64_t s_not_object_mask = s_integer_tag | s_other_tag;
+	static constexpr uint64_t s_constant_mask = 0x7;
+	static constexpr uint64_t s_double_offset = 1ull << 49;
+	static constexpr uint64_t s_canonical_nan = 0x7ff8000000000000;
+	static constexpr uint64_t s_sign_bit = 0x8000000000000000;
+
+	static constexpr int64_t s_integer_min = -(1ll << 48);
+	static constexpr int64_t s_integer_max = (1ll << 48) - 1;
+
+	static constexpr uint64_t s_nil = 0x2;
+	static constexpr uint64_t s_false = 0x6;
+	static constexpr uint64_t s_true = 0x7;
+
+	const RefCounted* object() const { return reinterpret_cast<const RefCounted*>(static_cast<uintptr_t>(m_bits)); }
+
+	void ref() const
+	{
+		if (isObject()) {
+			object()->ref();
+		}
+	}
+
+	void unref() const
+	{
+		if (isObject()) {
+			object()->unref();
+		}
+	}
+
+	uint64_t m_bits { 0 };
+};
+
+// -----------------------------------------
+
+// Receives the references reported by RefCounted::trace()
+class Tracer {
+public:
+	virtual ~Tracer() = default;
+
+	virtual void visit(const RefCounted* object) = 0;
+
+	void visit(const ValuePtr& value)
+	{
+		if (value.isObject()) {
+			visit(value.object());
+		}
+	}
+
+	template<typename T>
+	void visit(const RefPtr<T>& pointer)
+	{
+		if (pointer) {
+			visit(static_cast<const RefCounted*>(pointer.get()));
+		}
+	}
+};
+
+} // namespace blaze
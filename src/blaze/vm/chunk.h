@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2023 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint> // uint8_t, uint32_t
+#include <cstring> // std::memcpy
+#include <vector>
+
+#include "blaze/forward.h"
+
+namespace blaze {
+
+// Every instruction is a single opcode byte followed by its operands, which
+// are 32-bit unless noted otherwise. The stack effect is shown on the right.
+enum class OpCode : uint8_t {
+	Constant,        // index                   -> value
+	Pop,             //                   value ->
+	GetLocal,        // depth, slot, symbol     -> value
+	GetGlobal,       // symbol                  -> value
+	SetLocal,        // slot              value ->
+	DefVariable,     // symbol            value -> value
+	DefMacro,        // symbol           lambda -> macro
+	Jump,            // target
+	JumpIfFalse,     // target            value ->
+	JumpIfTrueOrPop, // target            value -> value, if it jumps
+	Call,            // count  function args... -> value
+	TailCall,        // count  function args... -> value
+	Return,          //                   value ->
+	Closure,         // prototype               -> lambda
+	MakeVector,      // count         values... -> vector
+	MakeHashMap,     // count   key, value, ... -> hash-map
+	Build,           // template      values... -> list or vector, for quasiquote
+	PushScope,       // scope, new Environment for let*
+	PopScope,        // back to the outer Environment
+	MacroCheck,      // form, tail (8-bit), target, expansion, expands the call if the function is a Macro
+	IntrinsicCheck,  // symbol, form, tail (8-bit), target, expansion, compiles the call again if the Symbol is rebound
+	Intrinsic,       // symbol, count           args... -> value, see Eval::intrinsic()
+	Evaluate,        // form                    -> value, using Eval
+	PushHandler,     // target, scope
+	PopHandler,
+};
+
+// The parts of a fn* needed to create a Lambda at runtime
+struct Prototype {
+	std::vector<uint32_t> bindings; // Symbol IDs
+	ScopePtr scope;
+	ValuePtr body;
+	ChunkPtr chunk;
+};
+
+// Shape of a quasiquote collection, the values of its elements are on the stack
+struct Template {
+	std::vector<bool> splices; // Per element, splice its value when true
+	bool vector { false };
+};
+
+// Compiled expansion of the last Macro called at a MacroCheck, or the call of
+// an IntrinsicCheck after its Symbol was rebound
+struct Expansion {
+	ValuePtr macro;
+	ChunkPtr chunk;
+};
+
+// Compiled form, see Compiler
+class Chunk {
+public:
+	Chunk() = default;
+	virtual ~Chunk() = default;
+
+	const std::vector<uint8_t>& code() const { return m_code; }
+	const ValueVector& constants() const { return m_constants; }
+	const std::vector<Prototype>& prototypes() const { return m_prototypes; }
+	const std::vector<ScopePtr>& scopes() const { return m_scopes; }
+	const std::vector<Template>& templates() const { return m_templates; }
+	std::vector<Expansion>& expansions() { return m_expansions; }
+
+	static uint32_t read(const uint8_t*& ip)
+	{
+		uint32_t operand;
+		std::memcpy(&operand, ip, sizeof(operand));
+		ip += sizeof(operand);
+		return operand;
+	}
+
+private:
+	friend class Compiler;
+
+	std::vector<uint8_t> m_code;
+	ValueVector m_constants;
+	std::vector<Prototype> m_prototypes;
+	std::vector<ScopePtr> m_scopes;
+	std::vector<Template> m_templates;
+	std::vector<Expansion> m_expansions;
+};
+
+} // namespace blaze
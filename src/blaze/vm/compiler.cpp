@@ -0,0 +1,628 @@
+/*
+ * Copyright (C) 2023 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <cstddef>  // size_t
+#include <cstdint>  // uint8_t, uint32_t
+#include <cstring>  // std::memcpy
+#include <iterator> // std::advance, std::next, std::prev
+#include <memory>   // std::make_shared
+#include <span>
+#include <utility>  // std::exchange, std::move
+#include <vector>
+
+#include "blaze/ast.h"
+#include "blaze/env/environment.h"
+#include "blaze/error.h"
+#include "blaze/eval.h"
+#include "blaze/forward.h"
+#include "blaze/types.h"
+#include "blaze/util.h"
+#include "blaze/vm/chunk.h"
+#include "blaze/vm/compiler.h"
+
+namespace blaze {
+
+Compiler::Compiler(const ScopePtr& scope)
+	: m_chunk(std::make_shared<Chunk>())
+	, m_scope(scope)
+{
+}
+
+ChunkPtr Compiler::compile(const ValuePtr& ast, const ScopePtr& scope, bool tail)
+{
+	Compiler compiler(scope);
+	if (!compiler.compileForm(ast, tail)) {
+		return nullptr;
+	}
+	compiler.emit(OpCode::Return);
+
+	return compiler.m_chunk;
+}
+
+// -----------------------------------------
+
+bool Compiler::compileForm(const ValuePtr& ast, bool tail)
+{
+	if (is<Symbol>(ast)) {
+		return compileSymbol(ast);
+	}
+	if (is<Vector>(ast)) {
+		return compileVector(ast);
+	}
+	if (is<HashMap>(ast)) {
+		return compileHashMap(ast);
+	}
+	if (!is<List>(ast) || valueCast<List>(ast)->empty()) {
+		emitConstant(ast);
+		return true;
+	}
+
+	auto list = valueCast<List>(ast);
+
+	// Special forms
+	if (is<Symbol>(list->front()) && valueCast<Symbol>(list->front())->isSpecialForm()) {
+		auto nodes = list->nodesRead().subspan(1);
+		switch (valueCast<Symbol>(list->front())->id()) {
+		case Symbol::Def:
+			return compileDef(nodes);
+		case Symbol::DefMacro:
+			return compileDefMacro(nodes);
+		case Symbol::Describe:
+		case Symbol::MacroExpand1:
+			// Rarely used, leave these to the tree-walking evaluator
+			emit(OpCode::Evaluate, addConstant(ast));
+			return true;
+		case Symbol::Fn:
+			return compileFn(nodes);
+		case Symbol::QuasiQuoteExpand:
+			return compileQuasiQuoteExpand(nodes);
+		case Symbol::Quote:
+			return compileQuote(nodes);
+		case Symbol::Try:
+			return compileTry(nodes);
+		case Symbol::And:
+			return compileAnd(nodes);
+		case Symbol::Do:
+			CHECK_ARG_COUNT_AT_LEAST("do", nodes.size(), 1, false);
+			return compileSequence(nodes.begin(), nodes.end(), tail);
+		case Symbol::If:
+			return compileIf(nodes, tail);
+		case Symbol::Let:
+			return compileLet(nodes, tail);
+		case Symbol::Or:
+			return compileOr(nodes);
+		case Symbol::QuasiQuote:
+			return compileQuasiQuote(nodes, tail);
+		case Symbol::While:
+			return compileWhile(nodes);
+		default:
+			break;
+		}
+	}
+
+	return compileCall(ast, tail);
+}
+
+// Only the value of the last form is kept, which is in tail position
+bool Compiler::compileSequence(ValueSpanIt begin, ValueSpanIt end, bool tail)
+{
+	for (auto it = begin; it != end; ++it) {
+		bool last = std::next(it) == end;
+		if (!compileForm(*it, last && tail)) {
+			return false;
+		}
+		if (!last) {
+			emit(OpCode::Pop);
+		}
+	}
+
+	return true;
+}
+
+bool Compiler::compileSymbol(const ValuePtr& ast)
+{
+	uint32_t symbol = valueCast<Symbol>(ast)->id();
+	auto address = Scope::resolve(m_scope.get(), symbol);
+	if (address.slot == Scope::Address::Global) {
+		emit(OpCode::GetGlobal, symbol);
+		return true;
+	}
+
+	emit(OpCode::GetLocal, address.depth);
+	emitOperand(address.slot);
+	emitOperand(symbol);
+
+	return true;
+}
+
+bool Compiler::compileVector(const ValuePtr& ast)
+{
+	const auto& nodes = valueCast<Collection>(ast)->nodesRead();
+	for (const auto& node : nodes) {
+		if (!compileForm(node, false)) {
+			return false;
+		}
+	}
+	emit(OpCode::MakeVector, nodes.size());
+
+	return true;
+}
+
+bool Compiler::compileHashMap(const ValuePtr& ast)
+{
+	const auto& elements = valueCast<HashMap>(ast)->elements();
+	for (const auto& [key, value] : elements) {
+		if (!compileForm(key, false)) {
+			return false;
+		}
+		if (!compileForm(value, false)) {
+			return false;
+		}
+	}
+	emit(OpCode::MakeHashMap, elements.size());
+
+	return true;
+}
+
+bool Compiler::compileCall(const ValuePtr& ast, bool tail)
+{
+	const auto& nodes = valueCast<List>(ast)->nodesRead();
+
+	// Only when the Symbol refers to the global builtin, not to a local
+	if (is<Symbol>(nodes.front())) {
+		uint32_t symbol = valueCast<Symbol>(nodes.front())->id();
+		if (Eval::isIntrinsic(symbol, nodes.size() - 1)
+		    && Scope::resolve(m_scope.get(), symbol).slot == Scope::Address::Global) {
+			return compileIntrinsic(ast, tail);
+		}
+	}
+
+	if (!compileForm(nodes.front(), false)) {
+		return false;
+	}
+
+	// Macros are only known at runtime, the check jumps over the arguments
+	// and the call when the function turns out to be a Macro
+	emit(OpCode::MacroCheck, addConstant(ast));
+	m_chunk->m_code.push_back(tail ? 1 : 0);
+	size_t skip = here();
+	emitOperand(0);
+	emitOperand(m_chunk->m_expansions.size());
+	m_chunk->m_expansions.emplace_back();
+
+	for (auto it = std::next(nodes.begin()); it != nodes.end(); ++it) {
+		if (!compileForm(*it, false)) {
+			return false;
+		}
+	}
+	emit((tail) ? OpCode::TailCall : OpCode::Call, nodes.size() - 1);
+
+	patchJump(skip);
+
+	return true;
+}
+
+bool Compiler::compileIntrinsic(const ValuePtr& ast, bool tail)
+{
+	const auto& nodes = valueCast<List>(ast)->nodesRead();
+	uint32_t symbol = valueCast<Symbol>(nodes.front())->id();
+
+	// The check jumps over the arguments and the intrinsic once the Symbol is
+	// rebound, the call is then compiled again as a regular one
+	emit(OpCode::IntrinsicCheck, symbol);
+	emitOperand(addConstant(ast));
+	m_chunk->m_code.push_back(tail ? 1 : 0);
+	size_t skip = here();
+	emitOperand(0);
+	emitOperand(m_chunk->m_expansions.size());
+	m_chunk->m_expansions.emplace_back();
+
+	for (auto it = std::next(nodes.begin()); it != nodes.end(); ++it) {
+		if (!compileForm(*it, false)) {
+			return false;
+		}
+	}
+	emit(OpCode::Intrinsic, symbol);
+	emitOperand(nodes.size() - 1);
+
+	patchJump(skip);
+
+	return true;
+}
+
+// -----------------------------------------
+
+bool Compiler::compileDef(ValueSpan nodes)
+{
+	CHECK_ARG_COUNT_IS("def!", nodes.size(), 2, false);
+
+	// First argument needs to be a Symbol
+	VALUE_CAST(symbol, Symbol, nodes.front(), false);
+
+	if (!compileForm(*std::next(nodes.begin()), false)) {
+		return false;
+	}
+	emit(OpCode::DefVariable, symbol->id());
+
+	return true;
+}
+
+bool Compiler::compileDefMacro(ValueSpan nodes)
+{
+	CHECK_ARG_COUNT_IS("defmacro!", nodes.size(), 2, false);
+
+	// First argument needs to be a Symbol
+	VALUE_CAST(symbol, Symbol, nodes.front(), false);
+
+	if (!compileForm(*std::next(nodes.begin()), false)) {
+		return false;
+	}
+	emit(OpCode::DefMacro, symbol->id());
+
+	return true;
+}
+
+bool Compiler::compileFn(ValueSpan nodes)
+{
+	CHECK_ARG_COUNT_AT_LEAST("fn*", nodes.size(), 2, false);
+
+	// First element needs to be a List or Vector
+	VALUE_CAST(collection, Collection, nodes.front(), false);
+	const auto& collection_nodes = collection->nodesRead();
+
+	std::vector<uint32_t> bindings;
+	std::vector<uint32_t> slots;
+	bindings.reserve(collection_nodes.size());
+	for (const auto& node : collection_nodes) {
+		// All nodes need to be a Symbol
+		VALUE_CAST(symbol, Symbol, node, false);
+		bindings.push_back(symbol->id());
+		if (symbol->id() != Symbol::Ampersand) {
+			slots.push_back(symbol->id());
+		}
+	}
+
+	// If more than one s-exp in lambda body, wrap in list
+	ValuePtr body = *std::next(nodes.begin());
+	if (nodes.size() > 2) {
+		auto body_nodes = ValueVector(nodes.size());
+		body_nodes.at(0) = Symbol::create(Symbol::Do);
+		std::copy(std::next(nodes.begin()), nodes.end(), body_nodes.begin() + 1);
+		body = makePtr<List>(body_nodes);
+	}
+
+	// The body is compiled once, every Lambda created from it shares the result
+	auto body_scope = Scope::create(m_scope, std::move(slots));
+	auto chunk = compile(body, body_scope, true);
+	if (chunk == nullptr) {
+		return false;
+	}
+
+	m_chunk->m_prototypes.push_back({ std::move(bindings), body_scope, body, chunk });
+	emit(OpCode::Closure, m_chunk->m_prototypes.size() - 1);
+
+	return true;
+}
+
+bool Compiler::compileQuasiQuoteExpand(ValueSpan nodes)
+{
+	CHECK_ARG_COUNT_IS("quasiquoteexpand", nodes.size(), 1, false);
+
+	auto result = Eval::quasiQuote(nodes.front());
+	if (Error::the().hasAnyError()) {
+		return false;
+	}
+	emitConstant(result);
+
+	return true;
+}
+
+bool Compiler::compileQuote(ValueSpan nodes)
+{
+	CHECK_ARG_COUNT_IS("quote", nodes.size(), 1, false);
+
+	emitConstant(nodes.front());
+	return true;
+}
+
+// The handler restores the stack and frame of the try* on an error, then
+// runs the catch* in a new scope with the binding set
+bool Compiler::compileTry(ValueSpan nodes)
+{
+	CHECK_ARG_COUNT_AT_LEAST("try*", nodes.size(), 1, false);
+
+	// Is last node a catch* block
+	bool is_last_node_catch = false;
+	std::span<const ValuePtr> catch_nodes;
+	if (nodes.size() >= 2 && is<List>(nodes.back())) {
+		VALUE_CAST(list, List, nodes.back(), false);
+		catch_nodes = list->nodesRead();
+		if (!list->empty() && is<Symbol>(catch_nodes.front())) {
+			VALUE_CAST(catch_symbol, Symbol, catch_nodes.front(), false);
+			if (catch_symbol->id() == Symbol::Catch) {
+				CHECK_ARG_COUNT_IS("catch*", catch_nodes.size() - 1, 2, false);
+				is_last_node_catch = true;
+			}
+		}
+	}
+
+	auto end = (!is_last_node_catch) ? nodes.end() : std::prev(nodes.end(), 1);
+	if (!is_last_node_catch) {
+		return compileSequence(nodes.begin(), end, false);
+	}
+
+	VALUE_CAST(catch_binding, Symbol, (*std::next(catch_nodes.begin())), false);
+
+	auto catch_scope = Scope::create(m_scope, { catch_binding->id() });
+
+	size_t handler = emitJump(OpCode::PushHandler);
+	emitOperand(addScope(catch_scope));
+	if (!compileSequence(nodes.begin(), end, false)) {
+		return false;
+	}
+	emit(OpCode::PopHandler);
+	size_t skip = emitJump(OpCode::Jump);
+
+	patchJump(handler);
+	auto scope = std::exchange(m_scope, catch_scope);
+	bool compiled = compileForm(catch_nodes.back(), false);
+	m_scope = scope;
+	if (!compiled) {
+		return false;
+	}
+	emit(OpCode::PopScope);
+
+	patchJump(skip);
+
+	return true;
+}
+
+// -----------------------------------------
+
+bool Compiler::compileAnd(ValueSpan nodes)
+{
+	if (nodes.empty()) {
+		emitConstant(makePtr<Constant>(Constant::True));
+		return true;
+	}
+
+	std::vector<size_t> falsy;
+	for (auto it = nodes.begin(); it != std::prev(nodes.end()); ++it) {
+		if (!compileForm(*it, false)) {
+			return false;
+		}
+		falsy.push_back(emitJump(OpCode::JumpIfFalse));
+	}
+
+	// The last value is the result, if it is truthy
+	if (!compileForm(nodes.back(), false)) {
+		return false;
+	}
+	size_t done = emitJump(OpCode::JumpIfTrueOrPop);
+
+	for (auto location : falsy) {
+		patchJump(location);
+	}
+	emitConstant(makePtr<Constant>(Constant::Nil));
+
+	patchJump(done);
+
+	return true;
+}
+
+bool Compiler::compileIf(ValueSpan nodes, bool tail)
+{
+	CHECK_ARG_COUNT_BETWEEN("if", nodes.size(), 2, 3, false);
+
+	if (!compileForm(nodes[0], false)) {
+		return false;
+	}
+	size_t otherwise = emitJump(OpCode::JumpIfFalse);
+
+	if (!compileForm(nodes[1], tail)) {
+		return false;
+	}
+	size_t done = emitJump(OpCode::Jump);
+
+	patchJump(otherwise);
+	if (!compileForm((nodes.size() == 3) ? nodes[2] : makePtr<Constant>(Constant::Nil), tail)) {
+		return false;
+	}
+
+	patchJump(done);
+
+	return true;
+}
+
+bool Compiler::compileLet(ValueSpan nodes, bool tail)
+{
+	CHECK_ARG_COUNT_IS("let*", nodes.size(), 2, false);
+
+	// First argument needs to be a List or Vector
+	VALUE_CAST(bindings, Collection, nodes.front(), false);
+	const auto& binding_nodes = bindings->nodesRead();
+
+	// List or Vector needs to have an even number of elements
+	CHECK_ARG_COUNT_EVEN("bindings", binding_nodes.size(), false);
+
+	// All symbols get their slot up front, so that a fn* in the bindings can
+	// refer to a binding that comes after it
+	auto let_scope = Scope::create(m_scope);
+	for (auto it = binding_nodes.begin(); it != binding_nodes.end(); std::advance(it, 2)) {
+		// First element needs to be a Symbol
+		VALUE_CAST(elt, Symbol, (*it), false);
+		let_scope->add(elt->id());
+	}
+
+	emit(OpCode::PushScope, addScope(let_scope));
+
+	auto scope = std::exchange(m_scope, let_scope);
+	bool compiled = true;
+	for (auto it = binding_nodes.begin(); compiled && it != binding_nodes.end(); std::advance(it, 2)) {
+		compiled = compileForm(*std::next(it), false);
+		emit(OpCode::SetLocal, let_scope->find(valueCast<Symbol>(*it)->id()));
+	}
+	compiled = compiled && compileForm(*std::next(nodes.begin()), tail);
+	m_scope = scope;
+	if (!compiled) {
+		return false;
+	}
+
+	// Not reached after a tail call, the frame has been replaced by then
+	emit(OpCode::PopScope);
+
+	return true;
+}
+
+bool Compiler::compileOr(ValueSpan nodes)
+{
+	std::vector<size_t> truthy;
+	for (const auto& node : nodes) {
+		if (!compileForm(node, false)) {
+			return false;
+		}
+		truthy.push_back(emitJump(OpCode::JumpIfTrueOrPop));
+	}
+
+	emitConstant(makePtr<Constant>(Constant::Nil));
+
+	for (auto location : truthy) {
+		patchJump(location);
+	}
+
+	return true;
+}
+
+bool Compiler::compileQuasiQuote(ValueSpan nodes, bool tail)
+{
+	CHECK_ARG_COUNT_IS("quasiquote", nodes.size(), 1, false);
+
+	return compileTemplate(nodes.front(), tail);
+}
+
+// The elements are built straight into the result instead of calling cons
+// and concat, see Template
+bool Compiler::compileTemplate(const ValuePtr& ast, bool tail)
+{
+	// Parts without unquotes are not rebuilt, just like quote
+	if (Eval::isQuasiQuoteConstant(ast)) {
+		emitConstant(ast);
+		return true;
+	}
+
+	// `~x or `~@x
+	auto unquote = Eval::startsWith(ast, Symbol::Unquote);
+	if (unquote == nullptr) {
+		unquote = Eval::startsWith(ast, Symbol::SpliceUnquote);
+	}
+	if (unquote) {
+		return compileForm(unquote, tail);
+	}
+	if (Error::the().hasAnyError()) {
+		return false;
+	}
+
+	Template shape;
+	shape.vector = is<Vector>(ast);
+	for (const auto& node : valueCast<Collection>(ast)->nodesRead()) {
+		auto splice_unquote = Eval::startsWith(node, Symbol::SpliceUnquote);
+		if (Error::the().hasAnyError()) {
+			return false;
+		}
+		if (!((splice_unquote) ? compileForm(splice_unquote, false) : compileTemplate(node, false))) {
+			return false;
+		}
+		shape.splices.push_back(splice_unquote != nullptr);
+	}
+
+	m_chunk->m_templates.push_back(std::move(shape));
+	emit(OpCode::Build, m_chunk->m_templates.size() - 1);
+
+	return true;
+}
+
+bool Compiler::compileWhile(ValueSpan nodes)
+{
+	CHECK_ARG_COUNT_AT_LEAST("while", nodes.size(), 2, false);
+
+	uint32_t loop = here();
+	if (!compileForm(nodes.front(), false)) {
+		return false;
+	}
+	size_t done = emitJump(OpCode::JumpIfFalse);
+
+	for (auto it = std::next(nodes.begin()); it != nodes.end(); ++it) {
+		if (!compileForm(*it, false)) {
+			return false;
+		}
+		emit(OpCode::Pop);
+	}
+	emit(OpCode::Jump, loop);
+
+	patchJump(done);
+	emitConstant(makePtr<Constant>());
+
+	return true;
+}
+
+// -----------------------------------------
+
+void Compiler::emit(OpCode op)
+{
+	m_chunk->m_code.push_back(static_cast<uint8_t>(op));
+}
+
+void Compiler::emit(OpCode op, uint32_t operand)
+{
+	emit(op);
+	emitOperand(operand);
+}
+
+void Compiler::emitConstant(ValuePtr value)
+{
+	emit(OpCode::Constant, addConstant(std::move(value)));
+}
+
+uint32_t Compiler::addConstant(ValuePtr value)
+{
+	m_chunk->m_constants.push_back(std::move(value));
+	return m_chunk->m_constants.size() - 1;
+}
+
+uint32_t Compiler::addScope(ScopePtr scope)
+{
+	m_chunk->m_scopes.push_back(std::move(scope));
+	return m_chunk->m_scopes.size() - 1;
+}
+
+void Compiler::emitOperand(uint32_t operand)
+{
+	auto& code = m_chunk->m_code;
+	code.resize(code.size() + sizeof(operand));
+	std::memcpy(code.data() + code.size() - sizeof(operand), &operand, sizeof(operand));
+}
+
+size_t Compiler::emitJump(OpCode op)
+{
+	emit(op);
+	size_t location = here();
+	emitOperand(0);
+
+	return location;
+}
+
+void Compiler::patchJump(size_t location)
+{
+	uint32_t target = here();
+	std::memcpy(m_chunk->m_code.data() + location, &target, sizeof(target));
+}
+
+uint32_t Compiler::here() const
+{
+	return m_chunk->m_code.size();
+}
+
+} // namespace blaze
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2023 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t
+
+#include "blaze/forward.h"
+#include "blaze/vm/chunk.h"
+
+namespace blaze {
+
+// Compiles a form into a Chunk of bytecode for the VM. Special forms are
+// resolved at compile time, calls are checked for macros at runtime as the
+// value of the head is only known then.
+class Compiler {
+public:
+	// The Chunk returns the value of the form, forms in tail position replace
+	// the frame they run in. Symbols are resolved against the Scope of the
+	// Environment the Chunk will run in.
+	static ChunkPtr compile(const ValuePtr& ast, const ScopePtr& scope, bool tail);
+
+private:
+	Compiler(const ScopePtr& scope);
+
+	bool compileForm(const ValuePtr& ast, bool tail);
+	bool compileSequence(ValueSpanIt begin, ValueSpanIt end, bool tail);
+
+	bool compileSymbol(const ValuePtr& ast);
+	bool compileVector(const ValuePtr& ast);
+	bool compileHashMap(const ValuePtr& ast);
+	bool compileCall(const ValuePtr& ast, bool tail);
+	bool compileIntrinsic(const ValuePtr& ast, bool tail);
+
+	bool compileDef(ValueSpan nodes);
+	bool compileDefMacro(ValueSpan nodes);
+	bool compileFn(ValueSpan nodes);
+	bool compileQuasiQuoteExpand(ValueSpan nodes);
+	bool compileQuote(ValueSpan nodes);
+	bool compileTry(ValueSpan nodes);
+
+	bool compileAnd(ValueSpan nodes);
+	bool compileIf(ValueSpan nodes, bool tail);
+	bool compileLet(ValueSpan nodes, bool tail);
+	bool compileOr(ValueSpan nodes);
+	bool compileQuasiQuote(ValueSpan nodes, bool tail);
+	bool compileTemplate(const ValuePtr& ast, bool tail);
+	bool compileWhile(ValueSpan nodes);
+
+	void emit(OpCode op);
+	void emit(OpCode op, uint32_t operand);
+	void emitConstant(ValuePtr value);
+	uint32_t addConstant(ValuePtr value);
+	uint32_t addScope(ScopePtr scope);
+	void emitOperand(uint32_t operand);
+
+	// Emit a jump to a target that is not known yet, returns the location of
+	// the operand to patch
+	size_t emitJump(OpCode op);
+	void patchJump(size_t location);
+	uint32_t here() const;
+
+	ChunkPtr m_chunk;
+	ScopePtr m_scope;
+};
+
+} // namespace blaze
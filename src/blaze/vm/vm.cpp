@@ -0,0 +1,489 @@
+/*
+ * Copyright (C) 2023 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <cstddef>  // size_t
+#include <cstdint>  // uint8_t, uint32_t
+#include <iterator> // std::make_move_iterator
+#include <utility>  // std::move
+
+#include "blaze/ast.h"
+#include "blaze/env/environment.h"
+#include "blaze/error.h"
+#include "blaze/eval.h"
+#include "blaze/forward.h"
+#include "blaze/types.h"
+#include "blaze/vm/chunk.h"
+#include "blaze/vm/compiler.h"
+#include "blaze/vm/vm.h"
+
+namespace blaze {
+
+static bool isTruthy(const ValuePtr& value)
+{
+	return !is<Constant>(value) || valueCast<Constant>(value)->state() == Constant::True;
+}
+
+VM::VM(s)
+{
+	m_stack.reserve(s_stack_size);
+}
+
+// -----------------------------------------
+
+ValuePtr VM::eval(const ValuePtr& ast, const EnvironmentPtr& env)
+{
+	if (Error::the().hasAnyError()) {
+		return nullptr;
+	}
+
+	auto chunk = Compiler::compile(ast, env->scope(), true);
+	return (chunk) ? run(std::move(chunk), env) : nullptr;
+}
+
+ValuePtr VM::apply(const ValuePtr& function, ValueVector&& arguments)
+{
+	if (is<Lambda>(function) || is<Macro>(function)) {
+		return expand(function, std::move(arguments));
+	}
+
+	if (!is<Function>(function)) {
+		Error::the().add(::format("invalid function: {}", function));
+		return nullptr;
+	}
+
+	return valueCast<Function>(function)->call(arguments);
+}
+
+ValuePtr VM::expand(const ValuePtr& macro, ValueVector&& arguments)
+{
+	auto body = chunk(macro);
+	if (body == nullptr) {
+		return nullptr;
+	}
+
+	auto env = Environment::create(macro, std::move(arguments));
+	return (env) ? run(std::move(body), std::move(env)) : nullptr;
+}
+
+// -----------------------------------------
+
+ValuePtr VM::run(ChunkPtr chunk, EnvironmentPtr env)
+{
+	size_t base_frame = m_frames.size();
+	m_frames.push_back({ std::move(chunk), 0, std::move(env), m_stack.size() });
+
+	return execute(base_frame);
+}
+
+// Run until the frame at base_frame returns, builtins can re-enter the VM
+ValuePtr VM::execute(size_t base_frame)
+{
+	const size_t base_stack = m_frames[base_frame].base;
+
+	Frame* frame = nullptr;
+	const uint8_t* code = nullptr;
+	const uint8_t* ip = nullptr;
+	const ValuePtr* constants = nullptr;
+
+	// Calls can push frames and reallocate them, always reload afterwards
+	auto load = [&]() {
+		frame = &m_frames.back();
+		code = frame->chunk->code().data();
+		ip = code + frame->ip;
+		constants = frame->chunk->constants().data();
+	};
+	auto save = [&]() {
+		frame->ip = ip - code;
+	};
+	// Run a Chunk compiled for the current call in place of that call
+	auto replace = [&](ChunkPtr chunk, bool tail) {
+		frame = &m_frames.back();
+		if (tail) {
+			frame->chunk = std::move(chunk);
+			frame->ip = 0;
+			m_stack.resize(frame->base);
+		}
+		else {
+			m_frames.push_back({ std::move(chunk), 0, frame->env, m_stack.size() });
+		}
+		load();
+	};
+
+	load();
+	while (true) {
+		switch (static_cast<OpCode>(*ip++)) {
+		case OpCode::Constant:
+			if (!push(constants[Chunk::read(ip)])) {
+				goto error;
+			}
+			break;
+		case OpCode::Pop:
+			m_stack.pop_back();
+			break;
+		case OpCode::GetLocal: {
+			Scope::Address address;
+			address.depth = Chunk::read(ip);
+			address.slot = Chunk::read(ip);
+			uint32_t symbol = Chunk::read(ip);
+			auto value = frame->env->get(address, symbol);
+			if (!value) {
+				Error::the().add(::format("'{}' not found", Symbol::create(symbol)));
+				goto error;
+			}
+			if (!push(std::move(value))) {
+				goto error;
+			}
+			break;
+		}
+		case OpCode::GetGlobal: {
+			uint32_t symbol = Chunk::read(ip);
+			auto value = frame->env->get(Scope::Address {}, symbol);
+			if (!value) {
+				Error::the().add(::format("'{}' not found", Symbol::create(symbol)));
+				goto error;
+			}
+			if (!push(std::move(value))) {
+				goto error;
+			}
+			break;
+		}
+		case OpCode::SetLocal:
+			frame->env->setSlot(Chunk::read(ip), std::move(m_stack.back()));
+			m_stack.pop_back();
+			break;
+		case OpCode::DefVariable:
+			frame->env->set(Chunk::read(ip), m_stack.back());
+			break;
+		case OpCode::DefMacro: {
+			uint32_t symbol = Chunk::read(ip);
+			auto& value = m_stack.back();
+			if (!is<Lambda>(value)) {
+				Error::the().add(::format("wrong argument type: Lambda, {}", value));
+				goto error;
+			}
+			value = makePtr<Macro>(*valueCast<Lambda>(value));
+			frame->env->set(symbol, value);
+			break;
+		}
+		case OpCode::Jump:
+			ip = code + Chunk::read(ip);
+			break;
+		case OpCode::JumpIfFalse: {
+			uint32_t target = Chunk::read(ip);
+			if (!isTruthy(m_stack.back())) {
+				ip = code + target;
+			}
+			m_stack.pop_back();
+			break;
+		}
+		case OpCode::JumpIfTrueOrPop: {
+			uint32_t target = Chunk::read(ip);
+			if (isTruthy(m_stack.back())) {
+				ip = code + target;
+				break;
+			}
+			m_stack.pop_back();
+			break;
+		}
+		case OpCode::Call:
+		case OpCode::TailCall: {
+			bool tail = static_cast<OpCode>(ip[-1]) == OpCode::TailCall;
+			uint32_t count = Chunk::read(ip);
+			save();
+			if (!call(m_stack[m_stack.size() - count - 1], count, tail)) {
+				goto error;
+			}
+			load();
+			break;
+		}
+		case OpCode::Return: {
+			auto result = std::move(m_stack.back());
+			m_stack.resize(frame->base);
+			m_frames.pop_back();
+			if (m_frames.size() == base_frame) {
+				return result;
+			}
+			m_stack.push_back(std::move(result));
+			load();
+			break;
+		}
+		case OpCode::Closure: {
+			const auto& prototype = frame->chunk->prototypes()[Chunk::read(ip)];
+			if (!push(makePtr<Lambda>(prototype.bindings, prototype.scope, prototype.body, prototype.chunk, frame->env))) {
+				goto error;
+			}
+			break;
+		}
+		case OpCode::MakeVector: {
+			uint32_t count = Chunk::read(ip);
+			auto nodes = ValueVector(std::make_move_iterator(m_stack.end() - count),
+			                         std::make_move_iterator(m_stack.end()));
+			m_stack.resize(m_stack.size() - count);
+			push(makePtr<Vector>(std::move(nodes)));
+			break;
+		}
+		case OpCode::MakeHashMap: {
+			uint32_t count = Chunk::read(ip);
+			Elements elements;
+			for (auto it = m_stack.end() - count * 2; it != m_stack.end(); it += 2) {
+				elements.insert_or_assign(*it, *(it + 1));
+			}
+			m_stack.resize(m_stack.size() - count * 2);
+			push(makePtr<HashMap>(elements));
+			break;
+		}
+		case OpCode::Build: {
+			const auto& shape = frame->chunk->templates()[Chunk::read(ip)];
+			size_t count = shape.splices.size();
+			auto values = m_stack.end() - count;
+			ValueVector nodes;
+			nodes.reserve(count);
+			for (size_t i = 0; i < count; ++i) {
+				if (!shape.splices[i]) {
+					nodes.push_back(std::move(values[i]));
+					continue;
+				}
+				if (!is<Collection>(values[i])) {
+					Error::the().add(::format("wrong argument type: Collection, {}", values[i]));
+					goto error;
+				}
+				const auto& spliced = valueCast<Collection>(values[i])->nodesRead();
+				nodes.insert(nodes.end(), spliced.begin(), spliced.end());
+			}
+			m_stack.resize(m_stack.size() - count);
+			if (shape.vector) {
+				push(makePtr<Vector>(std::move(nodes)));
+			}
+			else {
+				push(makePtr<List>(std::move(nodes)));
+			}
+			break;
+		}
+		case OpCode::PushScope:
+			frame->env = Environment::create(frame->env, frame->chunk->scopes()[Chunk::read(ip)]);
+			break;
+		case OpCode::PopScope:
+			frame->env = frame->env->outer();
+			break;
+		case OpCode::MacroCheck: {
+			const auto& form = constants[Chunk::read(ip)];
+			bool tail = *ip++;
+			uint32_t target = Chunk::read(ip);
+			uint32_t index = Chunk::read(ip);
+			if (!is<Macro>(m_stack.back())) {
+				break;
+			}
+
+			auto macro = std::move(m_stack.back());
+			m_stack.pop_back();
+			frame->ip = target;
+
+			// The expansion only depends on the Macro and the syntax of the
+			// call, so it is kept until the symbol is bound to a different Macro
+			auto chunk = frame->chunk->expansions()[index].chunk;
+			if (macro == frame->chunk->expansions()[index].macro) {
+				Eval::countSavedExpansion();
+			}
+			else {
+				auto list = valueCast<List>(form);
+				auto expanded = expand(macro, ValueVector(std::next(list->begin()), list->end()));
+				if (expanded == nullptr) {
+					goto error;
+				}
+				frame = &m_frames.back();
+				chunk = Compiler::compile(expanded, frame->env->scope(), tail);
+				if (chunk == nullptr) {
+					goto error;
+				}
+				frame->chunk->expansions()[index] = { macro, chunk };
+			}
+
+			replace(std::move(chunk), tail);
+			break;
+		}
+		case OpCode::IntrinsicCheck: {
+			uint32_t symbol = Chunk::read(ip);
+			const auto& form = constants[Chunk::read(ip)];
+			bool tail = *ip++;
+			uint32_t target = Chunk::read(ip);
+			uint32_t index = Chunk::read(ip);
+			if (!Environment::isRebound(symbol)) {
+				break;
+			}
+
+			frame->ip = target;
+
+			auto chunk = frame->chunk->expansions()[index].chunk;
+			if (chunk == nullptr) {
+				chunk = Compiler::compile(form, frame->env->scope(), tail);
+				if (chunk == nullptr) {
+					goto error;
+				}
+				frame->chunk->expansions()[index].chunk = chunk;
+			}
+
+			replace(std::move(chunk), tail);
+			break;
+		}
+		case OpCode::Intrinsic: {
+			uint32_t symbol = Chunk::read(ip);
+			uint32_t count = Chunk::read(ip);
+			auto arguments = m_stack.cend() - count;
+			auto result = Eval::intrinsic(symbol, &*arguments);
+			if (result == nullptr) {
+				save();
+				result = valueCast<Function>(Environment::builtin(symbol))->call(ValueSpan(arguments, m_stack.cend()));
+				if (result == nullptr && Error::the().hasAnyError()) {
+					goto error;
+				}
+				load();
+			}
+			m_stack.resize(m_stack.size() - count);
+			m_stack.push_back(std::move(result));
+			break;
+		}
+		case OpCode::Evaluate: {
+			const auto& form = constants[Chunk::read(ip)];
+			save();
+			Eval eval(form, frame->env);
+			eval.eval();
+			if (eval.ast() == nullptr && Error::the().hasAnyError()) {
+				goto error;
+			}
+			load();
+			if (!push(eval.ast())) {
+				goto error;
+			}
+			break;
+		}
+		case OpCode::PushHandler: {
+			uint32_t target = Chunk::read(ip);
+			const auto& scope = frame->chunk->scopes()[Chunk::read(ip)];
+			m_handlers.push_back({ m_frames.size() - 1, m_stack.size(), frame->env, scope, target });
+			break;
+		}
+		case OpCode::PopHandler:
+			m_handlers.pop_back();
+			break;
+		}
+		continue;
+
+	error:
+		if (!unwind(base_frame)) {
+			m_frames.resize(base_frame);
+			m_stack.resize(base_stack);
+			return nullptr;
+		}
+		load();
+	}
+}
+
+bool VM::call(const ValuePtr& function, size_t count, bool tail)
+{
+	size_t arguments = m_stack.size() - count;
+
+	if (is<Lambda>(function)) {
+		auto body = chunk(function);
+		if (body == nullptr) {
+			return false;
+		}
+
+		auto env = Environment::create(function, ValueVector(std::make_move_iterator(m_stack.begin() + arguments),
+		                                                     std::make_move_iterator(m_stack.end())));
+		if (env == nullptr) {
+			return false;
+		}
+
+		// Pop the function and its arguments, they now live in the Environment
+		if (tail) {
+			auto& frame = m_frames.back();
+			frame.chunk = std::move(body);
+			frame.ip = 0;
+			frame.env = std::move(env);
+			m_stack.resize(frame.base);
+			return true;
+		}
+
+		if (m_frames.size() == s_stack_size) {
+			Error::the().add("stack overflow");
+			return false;
+		}
+
+		m_stack.resize(arguments - 1);
+		m_frames.push_back({ std::move(body), 0, std::move(env), m_stack.size() });
+		return true;
+	}
+
+	if (is<Function>(function)) {
+		auto result = valueCast<Function>(function)->call(ValueSpan(m_stack.cbegin() + arguments, m_stack.cend()));
+		if (result == nullptr && Error::the().hasAnyError()) {
+			return false;
+		}
+
+		m_stack.resize(arguments - 1);
+		m_stack.push_back(std::move(result));
+		return true;
+	}
+
+	Error::the().add(::format("invalid function: {}", function));
+	return false;
+}
+
+bool VM::push(ValuePtr value)
+{
+	if (m_stack.size() == m_stack.capacity()) {
+		Error::the().add("stack overflow");
+		return false;
+	}
+
+	m_stack.push_back(std::move(value));
+	return true;
+}
+
+// Jump to the catch* of the innermost try*, as long as it belongs to this run
+bool VM::unwind(size_t base_frame)
+{
+	if (!Error::the().hasAnyError() || m_handlers.empty() || m_handlers.back().frame < base_frame) {
+		return false;
+	}
+
+	auto handler = std::move(m_handlers.back());
+	m_handlers.pop_back();
+
+	m_frames.resize(handler.frame + 1);
+	m_stack.resize(handler.stack);
+
+	// Get the error message
+	auto error = (Error::the().hasOtherError())
+	                 ? makePtr<String>(Error::the().otherError())
+	                 : Error::the().exception();
+	Error::the().clearErrors();
+
+	// Run the catch* in a new Environment that binds the value of the exception
+	auto& frame = m_frames.back();
+	frame.env = Environment::create(handler.env, handler.scope);
+	frame.env->setSlot(0, error);
+	frame.ip = handler.target;
+
+	return true;
+}
+
+// Lambdas created by Eval are compiled on their first call
+ChunkPtr VM::chunk(const ValuePtr& lambda)
+{
+	auto function = valueCast<Lambda>(lambda);
+	if (function->chunk() == nullptr) {
+		auto chunk = Compiler::compile(function->body(), function->scope(), true);
+		if (chunk == nullptr) {
+			return nullptr;
+		}
+		function->setChunk(chunk);
+	}
+
+	return function->chunk();
+}
+
+} // namespace blaze
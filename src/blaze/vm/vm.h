@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2023 Riyyi
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t
+#include <vector>
+
+#include "ruc/singleton.h"
+
+#include "blaze/forward.h"
+
+namespace blaze {
+
+// Stack-based virtual machine that runs the bytecode of the Compiler, the
+// counterpart of Eval. Both share the same Environments and Lambdas, so
+// values can freely cross from one engine to the other.
+class VM final : public ruc::Singleton<VM> {
+public:
+	VM(s);
+	virtual ~VM() = default;
+
+	ValuePtr eval(const ValuePtr& ast, const EnvironmentPtr& env);
+
+	// Call a Function or Lambda with evaluated arguments
+	ValuePtr apply(const ValuePtr& function, ValueVector&& arguments);
+	// Call a Macro with the unevaluated arguments, returning the expansion
+	ValuePtr expand(const ValuePtr& macro, ValueVector&& arguments);
+
+private:
+	struct Frame {
+		ChunkPtr chunk;
+		size_t ip { 0 };
+		EnvironmentPtr env;
+		size_t base { 0 }; // Stack size on entry
+	};
+
+	// Active try*, an error unwinds to the innermost one
+	struct Handler {
+		size_t frame { 0 };
+		size_t stack { 0 };
+		EnvironmentPtr env;
+		ScopePtr scope; // Slot of the catch* binding
+		uint32_t target { 0 };
+	};
+
+	ValuePtr run(ChunkPtr chunk, EnvironmentPtr env);
+	ValuePtr execute(size_t base_frame);
+	bool call(const ValuePtr& function, size_t count, bool tail);
+	bool push(ValuePtr value);
+	bool unwind(size_t base_frame);
+
+	ChunkPtr chunk(const ValuePtr& lambda);
+
+	// Builtins get iterators into the stack, so it must never reallocate
+	static constexpr size_t s_stack_size = 1024 * 1024;
+
+	ValueVector m_stack;
+	std::vector<Frame> m_frames;
+	std::vector<Handler> m_handlers;
+};
+
+} // namespace blaze